@@ -0,0 +1,57 @@
+/**
+ * @file AVLBalance.hpp
+ * @brief Defines the AVL rebalancing shared by FileAVL (which rotates Nodes in place) and PersistentFileAVL
+ *    (which rotates by building new Nodes)
+ */
+
+#pragma once
+
+/**
+ * @brief Determines the height of a given Node, or -1 if given a null link
+ */
+template <class Link>
+int avlHeight(const Link& n) {
+   return n ? n->height_ : -1;
+}
+
+/**
+ * @brief Joins top to the subtrees left and right, rotating once (single or double) if their heights are
+ *    out of balance, and returns the root of the result. A single insert or remove leaves the heights at most
+ *    2 apart, so one rotation is always enough.
+ *
+ * @param allowed_imbalance The most the heights of two sibling subtrees may differ by
+ * @param top Whatever join() needs to rebuild the top Node from: usually a link to it
+ * @param join Called as join(node, left, right) to get node with the given children (and its height and
+ *    aggregates brought up to date), where node is top or one of the Nodes being rotated. It may update
+ *    node in place or build a new Node; every child it needs has been read before it is called.
+ */
+template <class Top, class Link, class Join>
+Link avlBalance(int allowed_imbalance, const Top& top, const Link& left, const Link& right, Join join) {
+   if (avlHeight(left) - avlHeight(right) > allowed_imbalance) {
+      Link k1 = left, outer = k1->left_, inner = k1->right_;
+      if (avlHeight(outer) >= avlHeight(inner)) {
+         // Rotate with the left child
+         Link k2 = join(top, inner, right);
+         return join(k1, outer, k2);
+      }
+      // Double rotation: the left child's right child ends up on top
+      Link pivot = inner, pl = pivot->left_, pr = pivot->right_;
+      Link lt = join(k1, outer, pl);
+      Link rt = join(top, pr, right);
+      return join(pivot, lt, rt);
+   }
+   if (avlHeight(right) - avlHeight(left) > allowed_imbalance) {
+      Link k2 = right, outer = k2->right_, inner = k2->left_;
+      if (avlHeight(outer) >= avlHeight(inner)) {
+         // Rotate with the right child
+         Link k1 = join(top, left, inner);
+         return join(k2, k1, outer);
+      }
+      // Double rotation: the right child's left child ends up on top
+      Link pivot = inner, pl = pivot->left_, pr = pivot->right_;
+      Link lt = join(top, left, pl);
+      Link rt = join(k2, pr, outer);
+      return join(pivot, lt, rt);
+   }
+   return join(top, left, right);
+}
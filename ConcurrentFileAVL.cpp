@@ -0,0 +1,153 @@
+#include "ConcurrentFileAVL.hpp"
+
+#include <utility>
+
+/**
+ * @brief Counts a reader in for as long as it is in scope, so writers know not to free the root it may be reading
+ */
+class ConcurrentFileAVL::ReadSection {
+   public:
+   explicit ReadSection(const ConcurrentFileAVL& tree)
+      : active_{tree.readers_[tree.parity_.load()][readerSlot()].active_} {
+      active_.fetch_add(1);
+   }
+
+   ReadSection(const ReadSection&) = delete;
+   ReadSection& operator=(const ReadSection&) = delete;
+
+   ~ReadSection() { active_.fetch_sub(1); }
+
+   private:
+      std::atomic<size_t>& active_;
+};
+
+/**
+ * @brief Default Constructor: Construct a new, empty ConcurrentFileAVL
+ */
+ConcurrentFileAVL::ConcurrentFileAVL() : root_{new PersistentFileAVL::NodePtr()}, parity_{0}, readers_{}, write_{}, retired_{}, draining_{}, grace_parity_{0}, grace_step_{0} {}
+
+/**
+ * @brief Destroys the tree. No thread may still be using it.
+ */
+ConcurrentFileAVL::~ConcurrentFileAVL() {
+   for (const PersistentFileAVL::NodePtr* root : retired_) { delete root; }
+   for (const PersistentFileAVL::NodePtr* root : draining_) { delete root; }
+   delete root_.load();
+}
+
+/**
+ * @brief Returns the counter the calling thread uses, spreading threads over READER_SLOTS
+ */
+size_t ConcurrentFileAVL::readerSlot() {
+   static std::atomic<size_t> next_slot{0};
+   thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % READER_SLOTS;
+   return slot;
+}
+
+/**
+ * @brief Moves the grace period along as far as readers allow, without waiting for any (starting one if
+ *    a batch of roots is waiting), and frees its roots once it is over. Only called with write_ held.
+ */
+void ConcurrentFileAVL::reclaim() {
+   if (draining_.empty()) {
+      if (retired_.size() < RETIRE_BATCH) { return; }
+      // Steer new readers to the other set of counters; only the ones already counted can be on these roots
+      draining_.swap(retired_);
+      grace_parity_ = parity_.load();
+      parity_.store(1 - grace_parity_);
+      grace_step_ = 0;
+   }
+
+   // A reader of a draining root counted itself in before loading it, on one set of counters or the other.
+   // Drain the set it was steered away from, then steer readers back and drain the other: every such reader
+   // is waited for, and new readers always have a set nobody is waiting on.
+   while (true) {
+      size_t parity = grace_step_ == 0 ? grace_parity_ : 1 - grace_parity_;
+      for (const ReaderSlot& slot : readers_[parity]) {
+         if (slot.active_.load() != 0) { return; }
+      }
+      if (grace_step_ == 1) { break; }
+      parity_.store(grace_parity_);
+      grace_step_ = 1;
+   }
+
+   for (const PersistentFileAVL::NodePtr* root : draining_) { delete root; }
+   draining_.clear();
+}
+
+/**
+ * @brief Swaps in a new root and sets the old one aside, then reclaims what it can. Only called with write_ held.
+ */
+void ConcurrentFileAVL::publish(PersistentFileAVL::NodePtr next) {
+   retired_.push_back(root_.exchange(new PersistentFileAVL::NodePtr(std::move(next))));
+   reclaim();
+}
+
+/**
+ * @brief Takes a consistent, point-in-time view of the tree in O(1). Later writes are not reflected in it,
+ *    and it stays valid (and unchanged) for as long as it is kept. Safe to call from any thread.
+ */
+PersistentFileAVL ConcurrentFileAVL::snapshot() const {
+   ReadSection section(*this);
+   return PersistentFileAVL(*root_.load());
+}
+
+/**
+ * @brief Inserts a file while maintaining balance. Safe to call from any thread.
+ *
+ * @param target The file to be inserted
+ * @post Increases the size of the tree by 1, unless target is already in the tree (in which case nothing happens)
+ */
+void ConcurrentFileAVL::insert(File* target) {
+   std::lock_guard<std::mutex> lock(write_);
+   // Only writers replace the root, so the writer holding write_ can use it without counting itself in
+   PersistentFileAVL current(*root_.load());
+   PersistentFileAVL next = current.insert(target);
+   if (next != current) {
+      publish(std::move(next.root_));
+   }
+}
+
+/**
+ * @brief Removes a file while maintaining balance. Safe to call from any thread.
+ *
+ * @param target The file to be removed, which must still have the size it was inserted with
+ * @return True if target was found and removed, false otherwise
+ */
+bool ConcurrentFileAVL::remove(File* target) {
+   std::lock_guard<std::mutex> lock(write_);
+   PersistentFileAVL current(*root_.load());
+   PersistentFileAVL next = current.remove(target);
+   if (next == current) {
+      return false;
+   }
+   publish(std::move(next.root_));
+   return true;
+}
+
+/**
+ * @brief Retrieves all files whose file sizes are within [min, max], as of a single moment.
+ *    Safe to call from any number of threads, concurrently with insert() and remove().
+ *
+ * @return std::vector<File*> storing pointers to all files within the given range, in ascending order of size.
+ * @note If the query interval is in descending order (ie. the given parameters min >= max),
+         the interval from [max, min] is searched (since max >= min)
+ */
+std::vector<File*> ConcurrentFileAVL::query(size_t min, size_t max) const {
+   if (min > max) { std::swap(min, max); }
+
+   std::vector<File*> result;
+   ReadSection section(*this);
+   // The root (and so every Node under it) stays alive until the section ends, without taking a reference
+   PersistentFileAVL::search(root_.load()->get(), min, max, result);
+   return result;
+}
+
+/**
+ * @brief Returns the number of files in the tree
+ */
+size_t ConcurrentFileAVL::size() const {
+   ReadSection section(*this);
+   const PersistentFileAVL::NodePtr& root = *root_.load();
+   return root ? root->count_ : 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file ConcurrentFileAVL.hpp
+ * @brief Defines the interface for ConcurrentFileAVL, a FileAVL that many threads may read while one writes
+ */
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "File.hpp"
+#include "PersistentFileAVL.hpp"
+
+/**
+ * @brief A size-keyed AVL tree of files with the same contract as FileAVL, safe to share between threads.
+ *    It holds the latest PersistentFileAVL: a writer builds the next version (copying only the path to the change)
+ *    and swaps in its root with a single atomic pointer exchange, so readers always see a complete tree.
+ *
+ *    Reads are RCU-style: a reader announces itself on a counter of its own (one of READER_SLOTS, each on its own
+ *    cache line), loads the root pointer and walks the tree without touching any reference count, so readers never
+ *    block and do not contend with each other or with writers. The cost moves to the writers: a replaced root is
+ *    set aside, and freed by a later write once every reader that was under way when it was replaced has finished.
+ *    Writers only ever check for that, never wait on readers: while readers are slow to finish (eg. preempted
+ *    mid-query, with more threads than cores) old roots simply pile up until a later write finds them done.
+ *    A Node is reclaimed once no version (including any snapshot()) holds it. Writers are serialized among themselves.
+ */
+class ConcurrentFileAVL {
+   public:
+   /**
+    * @brief Default Constructor: Construct a new, empty ConcurrentFileAVL
+    */
+   ConcurrentFileAVL();
+
+   ConcurrentFileAVL(const ConcurrentFileAVL&) = delete;
+   ConcurrentFileAVL& operator=(const ConcurrentFileAVL&) = delete;
+
+   /**
+    * @brief Retrieves all files whose file sizes are within [min, max], as of a single moment.
+    *    Safe to call from any number of threads, concurrently with insert() and remove().
+    *
+    * @return std::vector<File*> storing pointers to all files within the given range, in ascending order of size.
+    * @note If the query interval is in descending order (ie. the given parameters min >= max),
+            the interval from [max, min] is searched (since max >= min)
+    */
+   std::vector<File*> query(size_t min, size_t max) const;
+
+   /**
+    * @brief Inserts a file while maintaining balance. Safe to call from any thread.
+    *
+    * @param target The file to be inserted
+    * @post Increases the size of the tree by 1, unless target is already in the tree (in which case nothing happens)
+    */
+   void insert(File* target);
+
+   /**
+    * @brief Removes a file while maintaining balance. Safe to call from any thread.
+    *
+    * @param target The file to be removed, which must still have the size it was inserted with
+    * @return True if target was found and removed, false otherwise
+    */
+   bool remove(File* target);
+
+   /**
+    * @brief Returns the number of files in the tree
+    */
+   size_t size() const;
+
+   /**
+    * @brief Takes a consistent, point-in-time view of the tree in O(1). Later writes are not reflected in it,
+    *    and it stays valid (and unchanged) for as long as it is kept. Safe to call from any thread.
+    */
+   PersistentFileAVL snapshot() const;
+
+   /**
+    * @brief Destroys the tree. No thread may still be using it.
+    */
+   ~ConcurrentFileAVL();
+
+   private:
+      // The number of reader counters; threads beyond this many share them (correct, but they then contend)
+      static const size_t READER_SLOTS = 64;
+      // How many replaced roots are set aside before a grace period starts, so one covers many writes
+      static const size_t RETIRE_BATCH = 64;
+
+      struct alignas(64) ReaderSlot {
+         std::atomic<size_t> active_{0};  // The number of readers counted here that may be looking at a root
+      };
+
+      class ReadSection;
+
+      std::atomic<const PersistentFileAVL::NodePtr*> root_;  // The latest version, replaced (never changed) by writers
+      std::atomic<size_t> parity_;                           // Which set of counters new readers count themselves on
+      mutable ReaderSlot readers_[2][READER_SLOTS];
+      std::mutex write_;                                     // Held by the one writer allowed at a time
+      // Guarded by write_: replaced roots readers may still be on, those whose grace period is under way,
+      // and how far that is (0: waiting on the readers counted on grace_parity_ when it began, 1: on the rest)
+      std::vector<const PersistentFileAVL::NodePtr*> retired_;
+      std::vector<const PersistentFileAVL::NodePtr*> draining_;
+      size_t grace_parity_;
+      int grace_step_;
+
+      /**
+       * @brief Returns the counter the calling thread uses, spreading threads over READER_SLOTS
+       */
+      static size_t readerSlot();
+
+      /**
+       * @brief Swaps in a new root and sets the old one aside, then reclaims what it can. Only called with write_ held.
+       */
+      void publish(PersistentFileAVL::NodePtr next);
+
+      /**
+       * @brief Moves the grace period along as far as readers allow, without waiting for any (starting one if
+       *    a batch of roots is waiting), and frees its roots once it is over. Only called with write_ held.
+       */
+      void reclaim();
+};
@@ -0,0 +1,159 @@
+#include "ConcurrentFileTrie.hpp"
+
+#include <cctype>
+#include <thread>
+
+/**
+ * @brief Counts a search in on a shard for as long as it is in scope, so writers know not to change the copy it reads
+ */
+class ConcurrentFileTrie::ReadSection {
+    public:
+        explicit ReadSection(const Shard& shard) : indicator{shard.readers[shard.version.load()].active} {
+            indicator.fetch_add(1);
+        }
+
+        ReadSection(const ReadSection&) = delete;
+        ReadSection& operator=(const ReadSection&) = delete;
+
+        ~ReadSection() { indicator.fetch_sub(1); }
+
+    private:
+        std::atomic<size_t>& indicator;
+};
+
+/**
+ * @brief Default Constructor: Construct a new, empty ConcurrentFileTrie
+ */
+ConcurrentFileTrie::ConcurrentFileTrie() : shards{} {}
+
+/**
+ * @brief Returns the shard holding every name that starts with the same two characters as the given
+ *      (non-empty) name, case insensitive. A one character name counts '\0' as its second.
+ */
+size_t ConcurrentFileTrie::shardOf(const std::string& name) {
+    size_t first = std::tolower(static_cast<unsigned char>(name[0]));
+    size_t second = std::tolower(static_cast<unsigned char>(name[1]));
+    return (first * 37 + second) % SHARDS;
+}
+
+/**
+ * @brief Returns the shards that may hold names starting with prefix, case insensitive: one for two or more
+ *      characters, every shard any second character could lead to for one
+ */
+std::bitset<ConcurrentFileTrie::SHARDS> ConcurrentFileTrie::shardsOf(const std::string& prefix) {
+    std::bitset<SHARDS> result;
+    if (prefix.size() >= 2) {
+        result.set(shardOf(prefix));
+        return result;
+    }
+    std::string name = prefix + ' ';
+    for (int second = 0; second < 256; second++) {
+        name[1] = static_cast<char>(second);
+        result.set(shardOf(name));
+    }
+    return result;
+}
+
+/**
+ * @brief Waits until no search is counted on the given indicator of shard
+ */
+void ConcurrentFileTrie::waitForReaders(const Shard& shard, int version) {
+    while (shard.readers[version].active.load() != 0) {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * @brief Adds file into the ConcurrentFileTrie, case insensitive. Safe to call from any thread.
+ *      Searches that start once it returns find the file.
+ * 
+ * @param f The file to be added
+ */
+void ConcurrentFileTrie::addFile(File* f) {
+    const std::string& name = f->getName();
+    if (name.empty()) {
+        return;
+    }
+    Shard& shard = shards[shardOf(name)];
+    std::lock_guard<std::mutex> lock(shard.write);
+
+    // Nobody reads the idle copy: change it, then send new searches to it
+    int live = shard.live.load();
+    shard.tries[1 - live].addFile(f);
+    shard.live.store(1 - live);
+
+    // Searches still on the old copy counted themselves on one indicator or the other: steer new ones to
+    // the other indicator and drain this one, then the same the other way round
+    int version = shard.version.load();
+    waitForReaders(shard, 1 - version);
+    shard.version.store(1 - version);
+    waitForReaders(shard, version);
+
+    shard.tries[live].addFile(f);
+}
+
+/**
+ * @brief Searches for some prefix and returns a set of Files that begin with that prefix, case insensitive.
+ *      Safe to call from any thread; never blocks.
+ * 
+ * @param prefix Prefix that is being searched for
+ * @return Set of all Files with the same prefix, if found, else empty set.
+ */
+std::unordered_set<File*> ConcurrentFileTrie::getFilesWithPrefix(const std::string& prefix) const {
+    if (prefix.empty()) {
+        return {};
+    }
+    std::bitset<SHARDS> which = shardsOf(prefix);
+    std::unordered_set<File*> result;
+    for (size_t i = 0; i < SHARDS; i++) {
+        if (!which[i]) { continue; }
+        const Shard& shard = shards[i];
+        ReadSection section(shard);
+        std::unordered_set<File*> found = shard.tries[shard.live.load()].getFilesWithPrefix(prefix);
+        if (result.empty()) {
+            result.swap(found);
+        } else {
+            result.insert(found.begin(), found.end());
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Counts the Files that begin with some prefix, case insensitive. Safe to call from any thread; never blocks.
+ * 
+ * @param prefix Prefix that is being searched for
+ * @return The number of Files with the same prefix, or 0 if no match is found (or the prefix is empty)
+ */
+size_t ConcurrentFileTrie::countWithPrefix(const std::string& prefix) const {
+    if (prefix.empty()) {
+        return 0;
+    }
+    std::bitset<SHARDS> which = shardsOf(prefix);
+    size_t count = 0;
+    for (size_t i = 0; i < SHARDS; i++) {
+        if (!which[i]) { continue; }
+        const Shard& shard = shards[i];
+        ReadSection section(shard);
+        count += shard.tries[shard.live.load()].countWithPrefix(prefix);
+    }
+    return count;
+}
+
+/**
+ * @brief Finds the Files that begin with something within max_distance edits of some prefix, case insensitive.
+ *      The first characters may be among the edits, so every shard is searched in turn. Never blocks.
+ * 
+ * @param prefix Prefix that is being searched for, possibly misspelt
+ * @param max_distance The most edits allowed between the prefix and the start of a name
+ * @return Set of all Files whose name starts within max_distance edits of the prefix
+ */
+std::unordered_set<File*> ConcurrentFileTrie::getFilesWithFuzzyPrefix(const std::string& prefix, size_t max_distance) const {
+    std::unordered_set<File*> result;
+    for (const Shard& shard : shards) {
+        ReadSection section(shard);
+        std::unordered_set<File*> found = shard.tries[shard.live.load()].getFilesWithFuzzyPrefix(prefix, max_distance);
+        result.insert(found.begin(), found.end());
+    }
+    return result;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file ConcurrentFileTrie.hpp
+ * @brief Defines the interface for ConcurrentFileTrie, a FileTrie that many threads may search while others add files
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include "File.hpp"
+#include "FileTrie.hpp"
+
+/**
+ * @brief A FileTrie safe to share between threads. Names are split across SHARDS shards by their first two
+ *      (lower case) characters, so a prefix of two or more characters is answered by a single shard.
+ *
+ *      Each shard is a left-right pair of FileTries: readers search whichever copy is live, announcing themselves
+ *      on a counter (no lock), so searches never block, not even behind a writer to the same shard. A writer adds
+ *      the file to the idle copy, makes it live, waits for searches still under way on the other copy to finish
+ *      (searches that start meanwhile do not hold it up), then adds the file there too. The price is that every
+ *      name is stored twice, and that a writer may wait for the searches already running on its shard.
+ * @note There is no viewFilesWithPrefix(), since a view would outlive the read it was taken in
+ */
+class ConcurrentFileTrie {
+    public:
+        /**
+         * @brief Default Constructor: Construct a new, empty ConcurrentFileTrie
+         */
+        ConcurrentFileTrie();
+
+        ConcurrentFileTrie(const ConcurrentFileTrie&) = delete;
+        ConcurrentFileTrie& operator=(const ConcurrentFileTrie&) = delete;
+
+        /**
+         * @brief Adds file into the ConcurrentFileTrie, case insensitive. Safe to call from any thread.
+         *      Searches that start once it returns find the file.
+         * 
+         * @param f The file to be added
+         */
+        void addFile(File* f);
+
+        /**
+         * @brief Searches for some prefix and returns a set of Files that begin with that prefix, case insensitive.
+         *      Safe to call from any thread; never blocks.
+         * 
+         * @param prefix Prefix that is being searched for
+         * @return Set of all Files with the same prefix, if found, else empty set.
+         */
+        std::unordered_set<File*> getFilesWithPrefix(const std::string& prefix) const;
+
+        /**
+         * @brief Counts the Files that begin with some prefix, case insensitive. Safe to call from any thread;
+         *      never blocks.
+         * 
+         * @param prefix Prefix that is being searched for
+         * @return The number of Files with the same prefix, or 0 if no match is found (or the prefix is empty)
+         */
+        size_t countWithPrefix(const std::string& prefix) const;
+
+        /**
+         * @brief Finds the Files that begin with something within max_distance edits of some prefix, case insensitive.
+         *      The first characters may be among the edits, so every shard is searched in turn. Never blocks.
+         * 
+         * @param prefix Prefix that is being searched for, possibly misspelt
+         * @param max_distance The most edits allowed between the prefix and the start of a name
+         * @return Set of all Files whose name starts within max_distance edits of the prefix
+         */
+        std::unordered_set<File*> getFilesWithFuzzyPrefix(const std::string& prefix, size_t max_distance) const;
+
+    private:
+        static const size_t SHARDS = 256;
+
+        // Keeps a counter of readers on its own cache line, so that readers of one shard (or one side)
+        // never slow down threads using the neighbouring counters
+        struct alignas(64) ReadIndicator {
+            std::atomic<size_t> active{0};
+        };
+
+        struct Shard {
+            std::array<FileTrie, 2> tries;              // Identical copies, except while a write is under way
+            std::atomic<int> live{0};                   // The copy new searches read
+            std::atomic<int> version{0};                // The indicator new searches count themselves on
+            mutable std::array<ReadIndicator, 2> readers;
+            std::mutex write;                           // Held by the one writer to this shard allowed at a time
+        };
+        std::array<Shard, SHARDS> shards;
+
+        class ReadSection;
+
+        /**
+         * @brief Returns the shard holding every name that starts with the same two characters as the given
+         *      (non-empty) name, case insensitive. A one character name counts '\0' as its second.
+         */
+        static size_t shardOf(const std::string& name);
+
+        /**
+         * @brief Returns the shards that may hold names starting with prefix, case insensitive: one for two or more
+         *      characters, every shard any second character could lead to for one
+         */
+        static std::bitset<SHARDS> shardsOf(const std::string& prefix);
+
+        /**
+         * @brief Waits until no search is counted on the given indicator of shard
+         */
+        static void waitForReaders(const Shard& shard, int version);
+};
\ No newline at end of file
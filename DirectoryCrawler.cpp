@@ -0,0 +1,283 @@
+#include "DirectoryCrawler.hpp"
+#include "DirectoryScanner.hpp"
+#include "FileAVL.hpp"
+#include "FileTrie.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// The size of each thread's buffer for directory entries: large enough to list most directories in one system call
+const size_t ENTRY_BUFFER_BYTES = 64 << 10;
+
+/**
+ * @brief Calls fn(name, d_type) for every entry of the open directory fd, except "." and ".."
+ * @return False if the directory could not be read to the end
+ */
+template <typename Fn>
+bool forEachEntry(int fd, std::vector<char>& buffer, Fn fn) {
+   auto skip = [](const char* name) { return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')); };
+#ifdef SYS_getdents64
+   // The fixed part of a struct linux_dirent64, which the name follows
+   struct Header {
+      uint64_t ino_;
+      int64_t off_;
+      unsigned short reclen_;
+      unsigned char type_;
+   };
+   const size_t name_offset = offsetof(Header, type_) + 1;
+
+   while (true) {
+      long read = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+      if (read < 0) { return false; }
+      if (read == 0) { return true; }
+      for (long offset = 0; offset < read;) {
+         Header header;
+         std::memcpy(&header, buffer.data() + offset, name_offset);
+         const char* name = buffer.data() + offset + name_offset;
+         if (!skip(name)) { fn(name, header.type_); }
+         offset += header.reclen_;
+      }
+   }
+#else
+   int copy = dup(fd);
+   DIR* dir = copy < 0 ? nullptr : fdopendir(copy);
+   if (!dir) {
+      if (copy >= 0) { ::close(copy); }
+      return false;
+   }
+   while (dirent* entry = readdir(dir)) {
+      if (!skip(entry->d_name)) { fn(entry->d_name, entry->d_type); }
+   }
+   closedir(dir);
+   return true;
+#endif
+}
+
+}  // namespace
+
+/**
+ * @brief Constructs a crawler of the tree under root. Nothing is read until crawl() is called.
+ *
+ * @param threads How many threads to walk the tree with; 0 to use one per hardware thread
+ */
+DirectoryCrawler::DirectoryCrawler(std::string root, size_t threads)
+   : root_{std::move(root)}, threads_{threads ? threads : std::max(1u, std::thread::hardware_concurrency())}, workers_{},
+     pending_{0}, queued_{0}, idle_{0}, idle_mutex_{}, wake_{} {
+   while (root_.size() > 1 && root_.back() == '/') { root_.pop_back(); }
+   for (size_t i = 0; i < threads_; i++) {
+      workers_.push_back(std::make_unique<Worker>());
+   }
+}
+
+/**
+ * @brief Walks every directory under root (without following symbolic links), adding a File for each regular file
+ *    whose name is valid for a File. Entries with invalid names, and directories that cannot be read, are skipped.
+ *
+ * @return The number of Files added by this crawl
+ * @throws std::runtime_error If root itself cannot be read
+ */
+size_t DirectoryCrawler::crawl() {
+   size_t before = size();
+   pending_ = 0;
+   queued_ = 0;
+
+   // Listing the root here reports a bad root to the caller, and gives the threads their first directories
+   Worker& first = *workers_[0];
+   size_t first_files = first.files_.size(), first_skipped = first.skipped_;
+   std::vector<char> buffer(ENTRY_BUFFER_BYTES);
+   if (!list(first, root_, buffer, true)) {
+      int error = errno;
+      // Undo whatever was found before the root failed, so a later crawl starts clean (with no stale directories
+      // queued against a fresh count, and no Files found twice)
+      first.files_.erase(first.files_.begin() + first_files, first.files_.end());
+      first.skipped_ = first_skipped;
+      first.work_.clear();
+      pending_ = 0;
+      queued_ = 0;
+      throw std::runtime_error("Cannot read directory " + root_ + ": " + std::strerror(error));
+   }
+
+   std::vector<std::thread> threads;
+   for (size_t i = 1; i < threads_; i++) {
+      threads.emplace_back(&DirectoryCrawler::run, this, i);
+   }
+   run(0);
+   for (std::thread& t : threads) { t.join(); }
+   return size() - before;
+}
+
+/**
+ * @brief Crawls as above, then adds the Files found to tree and trie in one batch each, concurrently
+ *
+ * @return The number of Files added by this crawl
+ * @throws std::runtime_error If root itself cannot be read
+ */
+size_t DirectoryCrawler::crawl(FileAVL& tree, FileTrie& trie) {
+   std::vector<size_t> before;
+   for (const std::unique_ptr<Worker>& worker : workers_) { before.push_back(worker->files_.size()); }
+   size_t found = crawl();
+
+   std::vector<File*> batch;
+   batch.reserve(found);
+   for (size_t i = 0; i < workers_.size(); i++) {
+      for (auto itr = workers_[i]->files_.begin() + before[i]; itr != workers_[i]->files_.end(); ++itr) {
+         batch.push_back(&*itr);
+      }
+   }
+   // Both indexes only read the Files, so they can be built at the same time
+   std::thread building_trie([&trie, &batch] { trie.addFiles(batch.begin(), batch.end()); });
+   tree.insertBatch(batch);
+   building_trie.join();
+   return found;
+}
+
+/**
+ * @brief Runs on each thread: lists directories until there are none left anywhere
+ */
+void DirectoryCrawler::run(size_t self) {
+   std::vector<char> buffer(ENTRY_BUFFER_BYTES);
+   Worker& worker = *workers_[self];
+   std::string directory;
+   while (true) {
+      if (take(self, directory)) {
+         if (!list(worker, directory, buffer, false)) { worker.skipped_++; }
+         if (pending_.fetch_sub(1) == 1) {
+            // That was the last directory anywhere: the threads waiting for more can finish
+            wakeIdle(true);
+         }
+      } else if (pending_.load() == 0) {
+         // Nothing is queued, and nobody is listing a directory that could queue more
+         return;
+      } else {
+         // Others are still listing directories that may queue more: sleep until they do, or until the crawl is over.
+         // Counting in as idle first means anyone who queues work after the check below sees the count and wakes us.
+         idle_.fetch_add(1);
+         {
+            std::unique_lock<std::mutex> lock(idle_mutex_);
+            wake_.wait(lock, [&] { return queued_.load() > 0 || pending_.load() == 0; });
+         }
+         idle_.fetch_sub(1);
+      }
+   }
+}
+
+/**
+ * @brief Wakes one thread waiting for work, or all of them, if any are waiting
+ */
+void DirectoryCrawler::wakeIdle(bool all) {
+   if (idle_.load() == 0) {
+      return;
+   }
+   // Taking the lock orders this wake after any waiter's check of the condition, so none can miss it
+   std::lock_guard<std::mutex> lock(idle_mutex_);
+   if (all) {
+      wake_.notify_all();
+   } else {
+      wake_.notify_one();
+   }
+}
+
+/**
+ * @brief Takes the next directory to list: the newest from the thread's own queue, or else the oldest from another's
+ * @return False if every queue was empty
+ */
+bool DirectoryCrawler::take(size_t self, std::string& directory) {
+   {
+      Worker& own = *workers_[self];
+      std::lock_guard<std::mutex> lock(own.mutex_);
+      if (!own.work_.empty()) {
+         directory = std::move(own.work_.back());
+         own.work_.pop_back();
+         queued_.fetch_sub(1);
+         return true;
+      }
+   }
+   // The oldest directories are nearest the root, so a thief takes a large share of the remaining work
+   for (size_t i = 1; i < workers_.size(); i++) {
+      Worker& victim = *workers_[(self + i) % workers_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex_);
+      if (!victim.work_.empty()) {
+         directory = std::move(victim.work_.front());
+         victim.work_.pop_front();
+         queued_.fetch_sub(1);
+         return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * @brief Lists one directory: its regular files with valid names become Files in worker's buffer,
+ *    and its subdirectories join worker's queue
+ *
+ * @param follow Whether directory may be a symbolic link (only the root may)
+ * @return False if the directory could not be opened or read
+ */
+bool DirectoryCrawler::list(Worker& worker, const std::string& directory, std::vector<char>& buffer, bool follow) {
+   int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | (follow ? 0 : O_NOFOLLOW));
+   if (fd < 0) { return false; }
+
+   std::string prefix = directory == "/" ? directory : directory + "/";
+   std::vector<std::string> subdirectories;
+   bool complete = forEachEntry(fd, buffer, [&](const char* name, unsigned char type) {
+      if (DirectoryScanner::addEntry(fd, prefix, name, type, worker.files_, worker.skipped_)) {
+         subdirectories.push_back(prefix + name);
+      }
+   });
+   ::close(fd);
+
+   if (!subdirectories.empty()) {
+      pending_.fetch_add(subdirectories.size());
+      {
+         // Counted under the lock, so no thief can take a directory before it is counted
+         std::lock_guard<std::mutex> lock(worker.mutex_);
+         for (std::string& subdirectory : subdirectories) {
+            worker.work_.push_back(std::move(subdirectory));
+         }
+         queued_.fetch_add(subdirectories.size());
+      }
+      wakeIdle(subdirectories.size() > 1);
+   }
+   return complete;
+}
+
+/**
+ * @brief Returns every File found so far, in no particular order. Their addresses stay valid for as long as the crawler does.
+ */
+std::vector<File*> DirectoryCrawler::files() const {
+   std::vector<File*> result;
+   result.reserve(size());
+   for (const std::unique_ptr<Worker>& worker : workers_) {
+      for (File& f : worker->files_) { result.push_back(&f); }
+   }
+   return result;
+}
+
+/**
+ * @brief Returns the number of Files found so far
+ */
+size_t DirectoryCrawler::size() const {
+   size_t total = 0;
+   for (const std::unique_ptr<Worker>& worker : workers_) { total += worker->files_.size(); }
+   return total;
+}
+
+/**
+ * @brief Returns the number of entries skipped so far (invalid names, unreadable directories, and files that vanished mid-crawl)
+ */
+size_t DirectoryCrawler::skipped() const {
+   size_t total = 0;
+   for (const std::unique_ptr<Worker>& worker : workers_) { total += worker->skipped_; }
+   return total;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file DirectoryCrawler.hpp
+ * @brief Defines DirectoryCrawler, which indexes the files under a directory using a pool of work-stealing threads
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "File.hpp"
+
+class FileAVL;
+class FileTrie;
+
+/**
+ * @brief Finds the same Files as a DirectoryScanner, but walks the tree on many threads: each thread lists
+ *    directories from its own queue (reading entries in large getdents batches, and statting relative to the open
+ *    directory), queueing any subdirectories it finds for itself, and steals from the other queues once its own runs dry.
+ *    A thread that finds every queue empty while others are still listing sleeps until they queue more (or finish).
+ *    Each thread keeps the Files it makes in its own buffer; nothing is shared until the walk is over, when the
+ *    buffers are merged into the indexes in one batch each (the FileAVL and the FileTrie being built side by side).
+ *    The crawler owns the Files it makes, so it must outlive any index they are added to.
+ */
+class DirectoryCrawler {
+   public:
+   /**
+    * @brief Constructs a crawler of the tree under root. Nothing is read until crawl() is called.
+    *
+    * @param threads How many threads to walk the tree with; 0 to use one per hardware thread
+    */
+   explicit DirectoryCrawler(std::string root, size_t threads = 0);
+
+   DirectoryCrawler(const DirectoryCrawler&) = delete;
+   DirectoryCrawler& operator=(const DirectoryCrawler&) = delete;
+
+   /**
+    * @brief Walks every directory under root (without following symbolic links), adding a File for each regular file
+    *    whose name is valid for a File. Entries with invalid names, and directories that cannot be read, are skipped.
+    *
+    * @return The number of Files added by this crawl
+    * @throws std::runtime_error If root itself cannot be read
+    */
+   size_t crawl();
+
+   /**
+    * @brief Crawls as above, then adds the Files found to tree and trie in one batch each, concurrently
+    *
+    * @return The number of Files added by this crawl
+    * @throws std::runtime_error If root itself cannot be read
+    */
+   size_t crawl(FileAVL& tree, FileTrie& trie);
+
+   /**
+    * @brief Returns every File found so far, in no particular order. Their addresses stay valid for as long as the crawler does.
+    */
+   std::vector<File*> files() const;
+
+   /**
+    * @brief Returns the number of Files found so far
+    */
+   size_t size() const;
+
+   /**
+    * @brief Returns the number of entries skipped so far (invalid names, unreadable directories, and files that vanished mid-crawl)
+    */
+   size_t skipped() const;
+
+   private:
+      /**
+       * @brief One thread's queue of directories to list, and the Files it has found. Aligned so that
+       *    threads working on neighbouring Workers do not share a cache line.
+       */
+      struct alignas(64) Worker {
+         std::mutex mutex_;              // Guards work_, which other threads steal from
+         std::deque<std::string> work_;  // Directories to list: the owner takes from the back, thieves from the front
+         std::deque<File> files_;        // Only touched by the owner while crawling
+         size_t skipped_ = 0;
+      };
+
+      std::string root_;
+      size_t threads_;
+      std::vector<std::unique_ptr<Worker>> workers_;
+      std::atomic<size_t> pending_;      // Directories queued or being listed; the crawl is over once it reaches 0
+      std::atomic<size_t> queued_;       // Directories queued and not yet taken
+      std::atomic<size_t> idle_;         // Threads waiting (or about to wait) on wake_
+      std::mutex idle_mutex_;
+      std::condition_variable wake_;     // Signalled when directories are queued, or the crawl is over
+
+      void run(size_t self);
+      void wakeIdle(bool all);
+      bool take(size_t self, std::string& directory);
+      bool list(Worker& worker, const std::string& directory, std::vector<char>& buffer, bool follow);
+};
@@ -0,0 +1,142 @@
+#include "DirectoryScanner.hpp"
+#include "FileAVL.hpp"
+#include "FileTrie.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Constructs a scanner of the tree under root. Nothing is read until scan() is called.
+ */
+DirectoryScanner::DirectoryScanner(std::string root) : root_{std::move(root)}, files_{}, skipped_{0} {
+   while (root_.size() > 1 && root_.back() == '/') { root_.pop_back(); }
+}
+
+/**
+ * @brief Walks every directory under root (without following symbolic links), adding a File for each regular file
+ *    whose name is valid for a File. Entries with invalid names, and directories that cannot be read, are skipped.
+ *
+ * @return The number of Files added by this scan
+ * @throws std::runtime_error If root itself cannot be read
+ */
+size_t DirectoryScanner::scan() {
+   size_t before = files_.size();
+   std::vector<std::string> pending{root_};
+   bool at_root = true;
+
+   while (!pending.empty()) {
+      std::string directory = std::move(pending.back());
+      pending.pop_back();
+
+      // Only the root may be a symbolic link; below it, links are never followed (so there are no cycles)
+      int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | (at_root ? 0 : O_NOFOLLOW));
+      DIR* dir = fd < 0 ? nullptr : fdopendir(fd);
+      if (!dir) {
+         // fdopendir() only takes ownership of fd when it succeeds
+         int error = errno;
+         if (fd >= 0) { ::close(fd); }
+         if (at_root) {
+            throw std::runtime_error("Cannot read directory " + directory + ": " + std::strerror(error));
+         }
+         skipped_++;
+         continue;
+      }
+      at_root = false;
+
+      std::string prefix = directory == "/" ? directory : directory + "/";
+      while (dirent* entry = readdir(dir)) {
+         const char* name = entry->d_name;
+         if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) { continue; }
+
+         if (addEntry(fd, prefix, name, entry->d_type, files_, skipped_)) {
+            pending.push_back(prefix + name);
+         }
+      }
+      closedir(dir);
+   }
+   return files_.size() - before;
+}
+
+/**
+ * @brief Decides what one entry of an open directory is, and deals with it: a regular file with a valid name
+ *    becomes a File in files, while an invalid name (or an entry that vanished) counts as skipped.
+ *    The entry's type, when readdir gives one, saves a stat for everything but regular files.
+ *
+ * @param directory_fd The open directory the entry is in
+ * @param prefix The path of that directory, ending in '/'
+ * @param type The entry's d_type, which may be DT_UNKNOWN
+ * @return True if the entry is a directory, which the caller should walk in turn
+ */
+bool DirectoryScanner::addEntry(int directory_fd, const std::string& prefix, const char* name, unsigned char type,
+                                std::deque<File>& files, size_t& skipped) {
+   if (type == DT_DIR) {
+      return true;
+   }
+   if (type != DT_REG && type != DT_UNKNOWN) {
+      return false;
+   }
+   // Only a file's name has to be valid; an entry of unknown type may be a directory, so it is statted first
+   if (type == DT_REG && !File::isValidName(name)) {
+      skipped++;
+      return false;
+   }
+
+   struct stat st;
+   if (fstatat(directory_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+      skipped++;
+      return false;
+   }
+   if (S_ISDIR(st.st_mode)) {
+      return true;
+   }
+   if (!S_ISREG(st.st_mode)) {
+      return false;
+   }
+   if (!File::isValidName(name)) {
+      skipped++;
+   } else {
+      files.push_back(File::fromDisk(prefix + name, static_cast<size_t>(st.st_size)));
+   }
+   return false;
+}
+
+/**
+ * @brief Scans as above, then adds the Files found to tree and trie in one batch each
+ *
+ * @return The number of Files added by this scan
+ * @throws std::runtime_error If root itself cannot be read
+ */
+size_t DirectoryScanner::scan(FileAVL& tree, FileTrie& trie) {
+   size_t before = files_.size();
+   size_t found = scan();
+
+   std::vector<File*> batch;
+   batch.reserve(found);
+   for (auto itr = files_.begin() + before; itr != files_.end(); ++itr) {
+      batch.push_back(&*itr);
+   }
+   tree.insertBatch(batch);
+   trie.addFiles(batch.begin(), batch.end());
+   return found;
+}
+
+/**
+ * @brief Returns every File found so far. Their addresses stay valid for as long as the scanner does.
+ */
+const std::deque<File>& DirectoryScanner::files() const {
+   return files_;
+}
+
+/**
+ * @brief Returns the number of entries skipped so far (invalid names, unreadable directories, and files that vanished mid-scan)
+ */
+size_t DirectoryScanner::skipped() const {
+   return skipped_;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file DirectoryScanner.hpp
+ * @brief Defines DirectoryScanner, which indexes the files under a directory from their metadata alone
+ */
+
+#pragma once
+#include <deque>
+#include <string>
+
+#include "File.hpp"
+
+class FileAVL;
+class FileTrie;
+
+/**
+ * @brief Walks a directory tree and makes a disk-backed File (see File::fromDisk()) for every regular file in it,
+ *    using only what readdir and stat report: no file is opened, so scanning costs the same however large the files are.
+ *    Files are named as File::fromDisk() names them, so an on-disk name without an extension is indexed with ".txt"
+ *    added; getPath() still gives the real path. The scanner owns the Files it makes, so it must outlive any index
+ *    they are added to.
+ */
+class DirectoryScanner {
+   public:
+   /**
+    * @brief Constructs a scanner of the tree under root. Nothing is read until scan() is called.
+    */
+   explicit DirectoryScanner(std::string root);
+
+   DirectoryScanner(const DirectoryScanner&) = delete;
+   DirectoryScanner& operator=(const DirectoryScanner&) = delete;
+
+   /**
+    * @brief Walks every directory under root (without following symbolic links), adding a File for each regular file
+    *    whose name is valid for a File. Entries with invalid names, and directories that cannot be read, are skipped.
+    *
+    * @return The number of Files added by this scan
+    * @throws std::runtime_error If root itself cannot be read
+    */
+   size_t scan();
+
+   /**
+    * @brief Scans as above, then adds the Files found to tree and trie in one batch each
+    *
+    * @return The number of Files added by this scan
+    * @throws std::runtime_error If root itself cannot be read
+    */
+   size_t scan(FileAVL& tree, FileTrie& trie);
+
+   /**
+    * @brief Returns every File found so far. Their addresses stay valid for as long as the scanner does.
+    */
+   const std::deque<File>& files() const;
+
+   /**
+    * @brief Returns the number of entries skipped so far (invalid names, unreadable directories, and files that vanished mid-scan)
+    */
+   size_t skipped() const;
+
+   private:
+      // Walks trees the same way, so classifies entries with addEntry() too
+      friend class DirectoryCrawler;
+
+      std::string root_;
+      std::deque<File> files_;
+      size_t skipped_;
+
+      /**
+       * @brief Decides what one entry of an open directory is, and deals with it: a regular file with a valid name
+       *    becomes a File in files, while an invalid name (or an entry that vanished) counts as skipped.
+       *    The entry's type, when readdir gives one, saves a stat for everything but regular files.
+       *
+       * @param directory_fd The open directory the entry is in
+       * @param prefix The path of that directory, ending in '/'
+       * @param type The entry's d_type, which may be DT_UNKNOWN
+       * @return True if the entry is a directory, which the caller should walk in turn
+       */
+      static bool addEntry(int directory_fd, const std::string& prefix, const char* name, unsigned char type,
+                           std::deque<File>& files, size_t& skipped);
+};
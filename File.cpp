@@ -1,5 +1,17 @@
 #include "File.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 /**
 * @brief Constructs a new File object.
 * 
@@ -7,129 +19,271 @@
 *    - If the string contains any non-alphanumeric characters besides *exactly_one* period an InvalidFormatException is thrown
 *    - If no extension is provided (eg. there is no period within the provided filename) or nothing follows the period, then ".txt" is used as the extension
 *    - Default value of "NewFile.txt" if none provided or if filename is empty 
-* @param contents A string representing the contents of the file.
-* @param icon A poointer to an integer array with length ICON_DIM
+* @param contents A string representing the contents of the file. Taken by value, so a temporary is moved in rather than copied.
+* @param icon A poointer to an integer array with length ICON_DIM, allocated with new[]. The File takes ownership:
+*    the pixels are interned in the IconPool and the array is deleted.
 * @throws InvalidFormatException - An error that occurs if the filename is not valid by the above constraints.
 */
-File::File(const std::string& filename, const std::string& contents, int* icon) : filename_{""}, contents_{contents}, icon_{icon} {
+File::File(const std::string& filename, std::string contents, int* icon) : filename_{""}, contents_{nullptr}, icon_{adoptIcon(icon)}, disk_{nullptr} {
+   setContents(std::move(contents));
    if (filename.empty()) { filename_ = "NewFile.txt"; return; }
    // Validate filename
-   auto dot_position = filename.end();
-
-   for (auto itr = filename.begin(); itr != filename.end(); ++itr) {
-      const char& c = *itr;
-      
-      if (dot_position == filename.end() && c == '.') {
-         // If the dot_position has not been set (ie. equals the end) and we encounter a period
-         dot_position = itr;
-      } else if (!std::isalnum(c)) {
-         // We have found a non-alphanumeric character (including possibly *another* period by failing the first if-clause)
-         throw InvalidFormatException("Invalid file name: " + filename);
-      }
+   if (!isValidName(filename)) {
+      throw InvalidFormatException("Invalid file name: " + filename);
    }
 
-   filename_ = std::string(filename.begin(), dot_position);
-   
-   if (filename.end() - dot_position <= 1) {
+   size_t dot_position = filename.find('.');
+   if (dot_position == std::string::npos || dot_position + 1 == filename.size()) {
       // No period specified / no extension characters
+      dot_position = std::min(dot_position, filename.size());
+      filename_.reserve(dot_position + 4);
+      filename_.assign(filename, 0, dot_position);
       filename_ += ".txt";
    } else {
-      filename_ += std::string(dot_position, filename.end());
+      filename_ = filename;
    }   
 }
-      
+
+/**
+ * @brief Checks a name against the rules of the constructor, without constructing anything
+ * @return True if the constructor would accept filename (an empty filename is accepted; it becomes "NewFile.txt")
+ */
+bool File::isValidName(std::string_view filename) {
+   bool seen_dot = false;
+   for (char c : filename) {
+      if (!seen_dot && c == '.') {
+         seen_dot = true;
+      } else if (!std::isalnum(static_cast<unsigned char>(c))) {
+         // We have found a non-alphanumeric character (including possibly *another* period by failing the first if-clause)
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * @brief A file on disk backing a File: its path, and (once the contents are first asked for) its pages mapped into memory
+ */
+struct File::DiskContents {
+   std::string path_;
+   size_t size_;                 // The size the file was found with, reported by getSize()
+   std::once_flag mapped_;       // Maps the file the first time any copy of the File asks for its contents
+   const char* data_ = nullptr;
+   size_t length_ = 0;
+   std::once_flag copied_;       // Copies the mapped pages into copy_ the first time getContents() is called
+   std::string copy_;
+
+   DiskContents(std::string path, size_t size) : path_{std::move(path)}, size_{size} {}
+
+   DiskContents(const DiskContents&) = delete;
+   DiskContents& operator=(const DiskContents&) = delete;
+
+   ~DiskContents() {
+      if (data_) { munmap(const_cast<char*>(data_), length_); }
+   }
+
+   /**
+    * @brief Maps the file (on the first call only) and returns its contents
+    * @throws std::runtime_error If the file cannot be opened or mapped (a later call tries again)
+    */
+   std::string_view view() {
+      std::call_once(mapped_, [this] {
+         int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+         if (fd < 0) {
+            throw std::runtime_error("Cannot open " + path_ + ": " + std::strerror(errno));
+         }
+         // Map the file as it is now, which may differ from the size it was scanned with
+         struct stat st;
+         if (fstat(fd, &st) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Cannot stat " + path_ + ": " + std::strerror(error));
+         }
+         size_t length = static_cast<size_t>(st.st_size);
+         if (length > 0) {
+            void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+               int error = errno;
+               ::close(fd);
+               throw std::runtime_error("Cannot map " + path_ + ": " + std::strerror(error));
+            }
+            data_ = static_cast<const char*>(data);
+            length_ = length;
+         }
+         ::close(fd);
+      });
+      return std::string_view(data_, length_);
+   }
+};
+
+/**
+ * @brief Constructs a File backed by a file on disk, without reading it. The contents are mapped into memory
+ *    the first time they are asked for, and shared by every copy of the File.
+ *
+ * @param path The path of the file. Its last component is the name of the File, under the same rules as the constructor:
+ *    a name without an extension gains ".txt" (so "Makefile" is indexed as "Makefile.txt"), while getPath() keeps
+ *    the path as given, which is always the one the contents are read from.
+ * @param size The size of the file in bytes (eg. from stat), returned by getSize() without touching the disk
+ * @throws InvalidFormatException If the name is not valid, or the path has none
+ */
+File File::fromDisk(const std::string& path, size_t size) {
+   size_t slash = path.rfind('/');
+   std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+   if (name.empty()) {
+      throw InvalidFormatException("No file name in path: " + path);
+   }
+   File file(name);
+   file.disk_ = std::make_shared<DiskContents>(path, size);
+   return file;
+}
+
 /**
 
    * @brief Get the value stored in name_
    * 
-   * @return std::string 
+   * @return const std::string& A reference to the name, valid for as long as the File is (no copy is made)
    */
-std::string File::getName() const {
+const std::string& File::getName() const {
    return filename_;
 }
 
 /**
    * @brief Calculates and returns the size of the File Object (in bytes)
-   *    by summing the size of the file's content member using sizeOf()
+   *    by summing the size of the file's content member using sizeOf(). O(1), whether or not the contents are shared.
    * @note How does this relate to the string's length?
    */
 size_t File::getSize() const {
-   return contents_.size(); 
+   if (disk_) { return disk_->size_; }
+   return contents_ ? contents_->size() : 0; 
 }
 
 /**
    * @brief Get the value of contents_
+   * 
+   * @return const std::string& A reference to the contents, valid until the File is changed or destroyed (no copy is made)
+   */
+const std::string& File::getContents() const {
+   if (disk_) {
+      DiskContents& disk = *disk_;
+      std::call_once(disk.copied_, [&disk] { disk.copy_.assign(disk.view()); });
+      return disk.copy_;
+   }
+   static const std::string empty;
+   return contents_ ? *contents_ : empty;
+}
+
+/**
+   * @brief Get the contents without copying them into a std::string. For a File backed by a file on disk,
+   *    the file is mapped (once) and the view points straight at its pages.
+   *
+   * @return A view of the contents, valid until the File is changed or destroyed
+   * @throws std::runtime_error If the file on disk cannot be opened or mapped
+   */
+std::string_view File::getContentsView() const {
+   if (disk_) { return disk_->view(); }
+   return contents_ ? std::string_view(*contents_) : std::string_view();
+}
+
+/**
+   * @brief Returns the path of the file on disk backing the File, or an empty string if it is held in memory
+   */
+const std::string& File::getPath() const {
+   static const std::string none;
+   return disk_ ? disk_->path_ : none;
+}
+
+/**
+   * @brief Replaces the contents of the File (which is then held in memory). Copies of the File keep the contents they had.
+   * @param contents The new contents. Taken by value, so a temporary is moved in rather than copied.
+   */
+void File::setContents(std::string contents) {
+   disk_ = nullptr;
+   if (contents.empty()) {
+      contents_ = nullptr;
+   } else if (contents_ && contents_.use_count() == 1) {
+      // Nobody else can see our buffer, so it can be reused
+      *contents_ = std::move(contents);
+   } else {
+      contents_ = std::make_shared<std::string>(std::move(contents));
+   }
+}
+
+/**
+   * @brief Appends to the contents of the File. The contents are copied first if another File still shares them.
    */
-std::string File::getContents() const {
-   return contents_;
+void File::appendContents(const std::string& more) {
+   if (more.empty()) { return; }
+   if (disk_) {
+      // Bring the contents into memory, where they can be changed
+      std::string contents(getContentsView());
+      setContents(std::move(contents));
+   }
+   if (!contents_) {
+      contents_ = std::make_shared<std::string>(more);
+   } else if (contents_.use_count() == 1) {
+      contents_->append(more);
+   } else {
+      // Copy on write: the other owners keep the old contents
+      auto copy = std::make_shared<std::string>();
+      copy->reserve(contents_->size() + more.size());
+      copy->append(*contents_).append(more);
+      contents_ = std::move(copy);
+   }
 }
 
 
 /**
-* @brief Gets the value of the icon_ member
+ * @brief Interns an icon handed over by a caller and frees the caller's array
+ */
+IconPool::Handle File::adoptIcon(int* icon) {
+   IconPool::Handle handle = IconPool::intern(static_cast<const int*>(icon));
+   delete[] icon;
+   return handle;
+}
+
+/**
+* @brief Gets the pixels of the icon, or nullptr if the File has none
+* @return A pointer to ICON_DIM 8-bit pixels, shared with every File that has the same icon (so they must not be changed)
 */
-int* File::getIcon() const {
-   return icon_;
+const uint8_t* File::getIcon() const {
+   return icon_ ? icon_->data() : nullptr;
 }
 
 
 /**
-   * @brief Sets the value of icon_ to the given parameter. De-allocates the prevous array if necessary.
-   * @param new_icon A pointer to an integer array of length ICON_DIM
+   * @brief Sets the icon to the given pixels. Releases the previous icon if necessary.
+   * @param new_icon A pointer to an integer array of length ICON_DIM, allocated with new[].
+   *    The File takes ownership: the pixels are interned in the IconPool and the array is deleted.
    */
 void File::setIcon(int* new_icon) {
-   if (icon_) { delete[] icon_; }
-   icon_ = new_icon;
+   icon_ = adoptIcon(new_icon);
 } 
 
 /**
- * @brief Destroy the File object
+ * @brief Destroy the File object (releasing its share of the icon)
  */
-File::~File() {
-   if (icon_) { delete[] icon_; }
-}
+File::~File() {}
 
 /**
-* @brief (COPY CONSTRUCTOR) Constructs a new File object as a deep copy of the target File
+* @brief (COPY CONSTRUCTOR) Constructs a new File object as a copy of the target File.
+*    The contents and icon are shared rather than copied (the contents are copied only once either File changes them).
 */
-File::File(const File& rhs) : filename_{rhs.getName()}, contents_{rhs.getContents()}, icon_{nullptr} {
-   if (rhs.getIcon() == nullptr) { return; }
-   
-   // Create a deep copy of the icon array
-   icon_ = new int[ICON_DIM];
-   for (size_t pixel = 0; pixel < ICON_DIM; pixel++) {
-      icon_[pixel] = rhs.icon_[pixel];
-   }
-}
+File::File(const File& rhs) : filename_{rhs.filename_}, contents_{rhs.contents_}, icon_{rhs.icon_}, disk_{rhs.disk_} {}
 
 /**
-   * @brief (COPY ASSIGNMENT) Replaces the calling File's data members using a deep copy of the rhs File
+   * @brief (COPY ASSIGNMENT) Replaces the calling File's data members using a copy of the rhs File.
+   *    The contents and icon are shared rather than copied (the contents are copied only once either File changes them).
    * @param rhs The File object to be copied
 */
 File& File::operator=(const File& rhs) {
-   // Check for self-assignment (otherwise we delete the icon and try to copy it. No bueno!)
    if (this == &rhs) { return *this; }
 
-   filename_ = rhs.getName();
-   contents_ = rhs.getContents();
-   
-   // Since we don't validate unique icons, we may unintentionally 
-   // assign the same icon (via setter). Maybe (as pure hypothetical)
-   // we have all of them as some default icon and need not create multiple copies
-   if (icon_ == rhs.icon_) { return *this; }
-   
-   // If we can delete our icon, do so
-   if (icon_) { 
-      delete[] icon_; 
-      icon_ = nullptr;
-   }
-
-   // If the to-be-copied object has an icon, make a deep copy (otherwise, we terminate now)
-   if (rhs.getIcon() == nullptr) { return *this; }
-   icon_ = new int[ICON_DIM];
-   for (size_t pixel = 0; pixel < ICON_DIM; pixel++) {
-      icon_[pixel] = rhs.icon_[pixel];
-   }
+   // Assigning the name reuses our existing buffer when it is big enough; the contents are just shared
+   filename_ = rhs.filename_;
+   contents_ = rhs.contents_;
+   disk_ = rhs.disk_;
+   // Icons are immutable and interned, so copying one is just taking another reference to it
+   icon_ = rhs.icon_;
 
    return *this;
 }
@@ -139,9 +293,7 @@ File& File::operator=(const File& rhs) {
    * @param rhs The File whose data is moved
    * @post The rhs File object is left in a valid, but unspecified state ready to be deleted
    */
-File::File(File&& rhs) : filename_{ std::move(rhs.filename_) }, contents_{ std::move(rhs.contents_) }, icon_{rhs.icon_} {
-   rhs.icon_ = nullptr;
-}
+File::File(File&& rhs) : filename_{ std::move(rhs.filename_) }, contents_{ std::move(rhs.contents_) }, icon_{ std::move(rhs.icon_) }, disk_{ std::move(rhs.disk_) } {}
 
 /**
    * @brief (MOVE ASSIGNMENT) Move the rhs data to the calling file object
@@ -151,22 +303,12 @@ File::File(File&& rhs) : filename_{ std::move(rhs.filename_) }, contents_{ std::
    * @post The rhs File object is left in a valid, but unspecified state ready to be deleted
 */
 File& File::operator=(File&& rhs) {
-   // Check for self-assignment (otherwise errors occur when setting the icon member)
    if (this == &rhs) { return *this; }
    
    filename_ = std::move(rhs.filename_);
    contents_ = std::move(rhs.contents_);
-
-   // Note! This is an edge case, but since we do not check for uniqueness when assigning a new icon
-   // we may point two files to the same icon bitmap. So if we delete one, we delete both (no good!).
-
-   if (icon_ && icon_ != rhs.icon_) {
-      delete[] icon_;
-      icon_ = nullptr;
-   }
-   
-   icon_ = rhs.icon_;
-   rhs.icon_ = nullptr;
+   icon_ = std::move(rhs.icon_);
+   disk_ = std::move(rhs.disk_);
 
    return *this;
 }
@@ -187,8 +329,8 @@ std::ostream& operator<< (std::ostream& os, const File& target) {
 }
 
 /**
- * @brief Compaeres files based on their names, lexicographically
+ * @brief Compaeres files based on their names, lexicographically (in place, without copying either name)
  */
 bool File::operator<(const File& rhs) const {
-   return getName() < rhs.getName();
+   return filename_.compare(rhs.filename_) < 0;
 }
\ No newline at end of file
@@ -2,18 +2,29 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iterator>
+#include <memory>
 #include <cstdint>
+#include "IconPool.hpp"
 #include "InvalidFormatException.hpp"
 
 class File {
    private:
       std::string filename_;
-      std::string contents_;
-      int* icon_;
+      std::shared_ptr<std::string> contents_; // Shared between copies until one of them changes it; nullptr when empty
+      IconPool::Handle icon_; // Shared with every other File that has the same icon
 
-      static const size_t ICON_DIM = 256; // Representing a 16 x 16 bitmap
+      struct DiskContents;
+      std::shared_ptr<DiskContents> disk_; // For a File backed by a file on disk: its path, and its pages once mapped
+
+      static const size_t ICON_DIM = IconPool::ICON_DIM; // Representing a 16 x 16 bitmap
+
+      /**
+       * @brief Interns an icon handed over by a caller and frees the caller's array
+       */
+      static IconPool::Handle adoptIcon(int* icon);
 
    public: 
       /**
@@ -23,11 +34,30 @@ class File {
       *    - If the string contains any non-alphanumeric characters besides *exactly_one* period an InvalidFormatException is thrown
       *    - If no extension is provided (eg. there is no period within the provided filename) or nothing follows the period, then ".txt" is used as the extension
       *    - Default value of "NewFile.txt" if none provided or if filename is empty 
-      * @param contents A string representing the contents of the file.
-      * @param icon A poointer to an integer array with length ICON_DIM
+      * @param contents A string representing the contents of the file. Taken by value, so a temporary is moved in rather than copied.
+      * @param icon A poointer to an integer array with length ICON_DIM, allocated with new[]. The File takes ownership:
+      *    the pixels are interned in the IconPool and the array is deleted.
       * @throws InvalidFormatException - An error that occurs if the filename is not valid by the above constraints.
       */
-      File(const std::string& filename = "NewFile.txt", const std::string& contents = "", int* icon = nullptr);
+      File(const std::string& filename = "NewFile.txt", std::string contents = "", int* icon = nullptr);
+
+      /**
+       * @brief Constructs a File backed by a file on disk, without reading it. The contents are mapped into memory
+       *    the first time they are asked for, and shared by every copy of the File.
+       *
+       * @param path The path of the file. Its last component is the name of the File, under the same rules as the constructor:
+       *    a name without an extension gains ".txt" (so "Makefile" is indexed as "Makefile.txt"), while getPath() keeps
+       *    the path as given, which is always the one the contents are read from.
+       * @param size The size of the file in bytes (eg. from stat), returned by getSize() without touching the disk
+       * @throws InvalidFormatException If the name is not valid, or the path has none
+       */
+      static File fromDisk(const std::string& path, size_t size);
+
+      /**
+       * @brief Checks a name against the rules of the constructor, without constructing anything
+       * @return True if the constructor would accept filename (an empty filename is accepted; it becomes "NewFile.txt")
+       */
+      static bool isValidName(std::string_view filename);
 
       /**
        * @brief Enables printing the object via std::cout
@@ -43,41 +73,75 @@ class File {
       /**
        * @brief Get the value stored in name_
        * 
-       * @return std::string 
+       * @return const std::string& A reference to the name, valid for as long as the File is (no copy is made)
        */
-      std::string getName() const;
+      const std::string& getName() const;
       
       /**
        * @brief Get the value of contents_
+       * 
+       * @return const std::string& A reference to the contents, valid until the File is changed or destroyed (no copy is made,
+       *    except the first time the contents of a File backed by a file on disk are read: see getContentsView())
+       * @throws std::runtime_error If the File is backed by a file on disk that cannot be opened or mapped
+       */
+      const std::string& getContents() const;
+
+      /**
+       * @brief Get the contents without copying them into a std::string. For a File backed by a file on disk,
+       *    the file is mapped (once) and the view points straight at its pages.
+       *
+       * @return A view of the contents, valid until the File is changed or destroyed
+       * @throws std::runtime_error If the file on disk cannot be opened or mapped
+       */
+      std::string_view getContentsView() const;
+
+      /**
+       * @brief Returns the path of the file on disk backing the File, or an empty string if it is held in memory
+       */
+      const std::string& getPath() const;
+
+      /**
+       * @brief Replaces the contents of the File (which is then held in memory). Copies of the File keep the contents they had.
+       * @param contents The new contents. Taken by value, so a temporary is moved in rather than copied.
+       */
+      void setContents(std::string contents);
+
+      /**
+       * @brief Appends to the contents of the File. The contents are copied first if another File still shares them.
        */
-      std::string getContents() const;
+      void appendContents(const std::string& more);
 
       /**
       * @brief Calculates and returns the size of the File Object (in bytes)
-      *    by summing the size of the file's content member using sizeOf()
+      *    by summing the size of the file's content member using sizeOf(). O(1), whether or not the contents are shared.
+      *    For a File backed by a file on disk, this is the size it was given, and the disk is not touched.
       * @note How does this relate to the string's length?
       */
       size_t getSize() const;
 
       /**
-       * @brief Gets the value of the icon_ member
+       * @brief Gets the pixels of the icon, or nullptr if the File has none
+       * @return A pointer to ICON_DIM 8-bit pixels, shared with every File that has the same icon (so they must not be changed)
        */
-      int* getIcon() const;
+      const uint8_t* getIcon() const;
 
       /**
-       * @brief Sets the value of icon_ to the given parameter. De-allocates the prevous array if necessary.
-       * @param new_icon A pointer to a length 256 (ie. ICON_DIM) array of unsigned 8 bit integers
+       * @brief Sets the icon to the given pixels. Releases the previous icon if necessary.
+       * @param new_icon A pointer to a length 256 (ie. ICON_DIM) array of unsigned 8 bit integers, allocated with new[].
+       *    The File takes ownership: the pixels are interned in the IconPool and the array is deleted.
        */
       void setIcon(int* new_icon); 
 
 
       /**
-       * @brief (COPY CONSTRUCTOR) Constructs a new File object as a deep copy of the target File
+       * @brief (COPY CONSTRUCTOR) Constructs a new File object as a copy of the target File.
+       *    The contents and icon are shared rather than copied (the contents are copied only once either File changes them).
        */
       File(const File& rhs);
 
       /**
-       * @brief (COPY ASSIGNMENT) Replaces the calling File's data members using a deep copy of the rhs File.
+       * @brief (COPY ASSIGNMENT) Replaces the calling File's data members using a copy of the rhs File.
+       *    The contents and icon are shared rather than copied (the contents are copied only once either File changes them).
        * 
        * @param rhs The File object to be copied
        * @note If copy assignment operator is invoked upon itself, do nothing.
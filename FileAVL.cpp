@@ -1,5 +1,7 @@
 #include "FileAVL.hpp"
 
+#include <thread>
+
 /**
  * @brief Determines the height of a given Node 
  * 
@@ -13,6 +15,30 @@ int FileAVL::height(Node* n) const {
    return n->height_;
 }
 
+/**
+ * @brief Returns the number of files in the subtree rooted at n (0 if given a nullptr)
+ */
+size_t FileAVL::count(Node* n) const {
+   return n ? n->count_ : 0;
+}
+
+/**
+ * @brief Returns the total bytes in the subtree rooted at n (0 if given a nullptr)
+ */
+size_t FileAVL::bytes(Node* n) const {
+   return n ? n->bytes_ : 0;
+}
+
+/**
+ * @brief Recomputes the height and subtree aggregates of t from its children
+ * @pre The children of t are up to date
+ */
+void FileAVL::update(Node* t) {
+   t->height_ = std::max( height( t->left_ ), height( t->right_ ) ) + 1;
+   t->count_ = count(t->left_) + t->files_.size() + count(t->right_);
+   t->bytes_ = bytes(t->left_) + t->size_ * t->files_.size() + bytes(t->right_);
+}
+
 /**
  * @brief Returns the size of the AVL tree
  */
@@ -59,40 +85,45 @@ void FileAVL::displayInOrder() const {
 }
 
 /**
- * @brief Helper for displayInOrder(). Prints the unique file sizes in-order given a specified root
+ * @brief Helper for displayInOrder(). Prints the unique file sizes in-order given a specified root,
+ *    using an explicit stack rather than recursion
  * @param root The root of the tree to be printed
  */
 void FileAVL::displayInOrder(Node* root) const {
-    if (!root) { return; }
-    
-    displayInOrder(root->left_);
-    std::cout << root->files_[0]->getSize() << " ";
-    displayInOrder(root->right_);
+    Node* stack[MAX_HEIGHT];
+    int depth = 0;
+
+    while (root || depth > 0) {
+        while (root) {
+            stack[depth++] = root;
+            root = root->left_;
+        }
+        root = stack[--depth];
+        std::cout << root->size_ << " ";
+        root = root->right_;
+    }
 }
 
 /**
  * @brief Default Constructor: Construct a new FileAVL object
  */
-FileAVL::FileAVL() : root_ {nullptr}, size_{0} {}
+FileAVL::FileAVL() : pool_{}, root_ {nullptr}, size_{0} {}
 
- /**
- * @brief Destroys the given Node and its children
+/**
+ * @brief Destroys every Node of the tree by releasing the pool in one go, rather than visiting each Node
  * 
- * @param t The node to be deleted
+ * @post root_ is nullptr
  */
-void FileAVL::deleteTree(Node*& t) {
-   if (t == nullptr) { return; }
-   deleteTree(t->left_);
-   deleteTree(t->right_);
-   delete t;
-   t = nullptr;
+void FileAVL::deleteTree() {
+   pool_.release();
+   root_ = nullptr;
 }
 
 /**
  * @brief Destroy the FileAVL, deallocating all necessary Nodes
  */
 FileAVL::~FileAVL() {
-   deleteTree(root_);
+   deleteTree();
 }
 
 /**
@@ -100,114 +131,526 @@ FileAVL::~FileAVL() {
  *    If a duplicate is found, increments the count within the Node of the associated value
  * 
  * @param target The value to be inserted
- * @post Increases the size of the tree by 1
+ * @post Increases the size of the tree by 1, unless target is already in the tree (in which case nothing happens)
+ * @note Files are tracked by pointer so they can be removed in O(1): inserting the same File* twice is a no-op,
+ *    where it used to add a second entry. Distinct File objects of the same size are still all kept.
  */
 void FileAVL::insert(File* target) {
+   if (slots_.count(target)) { return; }
    insert(target, root_);
    size_++;
 }
 
 /**
- * @brief Internal routine to insert into a subtree
+ * @brief Internal routine to insert into a subtree, iteratively.
+ *    The links followed on the way down are kept on an explicit path stack and rebalanced on the way back up.
  * 
  * @param target The value to insert
  * @param subroot The root of the subtree to be inserted into
  * @post Set the new root of the subtree
  */
 void FileAVL::insert(File*& target, Node*& subroot) {
-   if (subroot == nullptr) {
-      subroot = new Node({ target });
-   } else if (target->getSize() == subroot->files_.front()->getSize()) {
-      subroot->files_.push_back(target);
-   } else if (target->getSize() < subroot->files_.front()->getSize()) {
-      insert(target, subroot->left_);
+   Node** path[MAX_HEIGHT];
+   int depth = 0;
+   size_t size = target->getSize();
+
+   Node** link = &subroot;
+   while (*link && (*link)->size_ != size) {
+      path[depth++] = link;
+      link = size < (*link)->size_ ? &(*link)->left_ : &(*link)->right_;
+   }
+
+   bool grew = (*link == nullptr);
+   if (grew) {
+      *link = pool_.create(target);
+      slots_[target] = 0;
    } else {
-      insert(target, subroot->right_);
+      slots_[target] = (*link)->files_.size();
+      (*link)->files_.push_back(target, pool_);
+      update(*link);
+   }
+
+   // Rotations rewrite the contents of a link, never the link itself, so the saved links stay valid.
+   // Once a subtree stops growing only the aggregates above it can change, so skip balance() from there on.
+   while (depth > 0) {
+      Node*& t = *path[--depth];
+      if (grew) {
+         int before = t->height_;
+         balance(t);
+         grew = t->height_ != before;
+      } else {
+         update(t);
+      }
+   }
+}
+
+/**
+ * @brief Removes a file from the AVL tree while maintaining balance.
+ *    Removing a file from its Node is O(1) regardless of how many files share its size;
+ *    a Node left with no files is deleted from the tree.
+ * 
+ * @param target The file to be removed, which must still have the size it was inserted with
+ * @return True if target was found and removed, false otherwise
+ * @post Decreases the size of the tree by 1 if target was removed
+ */
+bool FileAVL::remove(File* target) {
+   if (!remove(target, target->getSize(), root_)) { return false; }
+   size_--;
+   return true;
+}
+
+/**
+ * @brief Re-keys a file whose size has changed since it was inserted (eg. after its contents were modified)
+ * 
+ * @param target The file whose size changed
+ * @param old_size The size target had when it was inserted (or last updated)
+ * @return True if target was found under old_size and moved to its current size, false otherwise
+ */
+bool FileAVL::updateSize(File* target, size_t old_size) {
+   if (old_size == target->getSize()) { return slots_.count(target) > 0; }
+   if (!remove(target, old_size, root_)) { return false; }
+   insert(target, root_);
+   return true;
+}
+
+/**
+ * @brief Internal routine to remove from a subtree, iteratively
+ * 
+ * @param target The file to remove
+ * @param size The size target is stored under
+ * @param subroot The root of the subtree to be removed from
+ * @return True if target was found and removed
+ * @post Set the new root of the subtree
+ */
+bool FileAVL::remove(File* target, size_t size, Node*& subroot) {
+   Node** path[MAX_HEIGHT];
+   int depth = 0;
+
+   Node** link = &subroot;
+   while (*link && (*link)->size_ != size) {
+      path[depth++] = link;
+      link = size < (*link)->size_ ? &(*link)->left_ : &(*link)->right_;
+   }
+   if (*link == nullptr) { return false; }
+
+   Node* t = *link;
+   auto slot = slots_.find(target);
+   if (slot == slots_.end() || slot->second >= t->files_.size() || t->files_[slot->second] != target) {
+      return false;
+   }
+
+   // Fill the hole with the last file of the Node, so nothing else has to shift
+   FileBucket& files = t->files_;
+   files[slot->second] = files.back();
+   slots_[files.back()] = slot->second;
+   files.pop_back();
+   slots_.erase(target);
+
+   if (!files.empty()) {
+      path[depth++] = link;
+   } else if (t->left_ && t->right_) {
+      // Two children: take over the files of the in-order successor, then unlink the successor instead
+      path[depth++] = link;
+      Node** successor = &t->right_;
+      while ((*successor)->left_) {
+         path[depth++] = successor;
+         successor = &(*successor)->left_;
+      }
+
+      Node* s = *successor;
+      std::swap(t->size_, s->size_);
+      std::swap(t->files_, s->files_);
+      *successor = s->right_;
+      pool_.destroy(s);
+   } else {
+      *link = t->left_ ? t->left_ : t->right_;
+      pool_.destroy(t);
+   }
+
+   while (depth > 0) {
+      balance(*path[--depth]);
+   }
+   return true;
+}
+
+/**
+ * @brief Inserts a batch of files at once.
+ *    Small batches (relative to the tree) are inserted one by one; otherwise the batch is sorted by size
+ *    (in parallel for large batches) and merged with the tree, which is then rebuilt bottom-up in O(N + M).
+ * 
+ * @param files The files to be inserted. Files already in the tree (or repeated in the batch) are ignored.
+ * @post Increases the size of the tree by the number of new files
+ */
+void FileAVL::insertBatch(const std::vector<File*>& files) {
+   std::vector<Entry> entries;
+   entries.reserve(files.size());
+   for (File* f : files) { entries.emplace_back(f->getSize(), f); }
+
+   sortBySize(entries);
+   merge(entries);
+}
+
+/**
+ * @brief Merges a batch of files that is already sorted by size into the tree, skipping the sort of insertBatch()
+ * 
+ * @param files The files to be inserted, in ascending order of getSize()
+ * @post Increases the size of the tree by the number of new files
+ */
+void FileAVL::insertSorted(const std::vector<File*>& files) {
+   std::vector<Entry> entries;
+   entries.reserve(files.size());
+   for (File* f : files) { entries.emplace_back(f->getSize(), f); }
+
+   merge(entries);
+}
+
+/**
+ * @brief Sorts entries by size, keeping files of equal size in their original order
+ */
+void FileAVL::sortBySize(std::vector<Entry>& entries) {
+   auto by_size = [](const Entry& a, const Entry& b) { return a.first < b.first; };
+   size_t threads = std::min<size_t>(std::thread::hardware_concurrency(), entries.size() / PARALLEL_SORT_THRESHOLD);
+
+   if (threads < 2) {
+      std::stable_sort(entries.begin(), entries.end(), by_size);
+      return;
+   }
+
+   // Sort one chunk per thread, then merge neighbouring chunks pairwise (also in parallel) until one run is left
+   std::vector<size_t> bounds;
+   for (size_t i = 0; i <= threads; i++) { bounds.push_back(entries.size() * i / threads); }
+
+   std::vector<std::thread> workers;
+   for (size_t i = 0; i < threads; i++) {
+      workers.emplace_back([&, i] { std::stable_sort(entries.begin() + bounds[i], entries.begin() + bounds[i + 1], by_size); });
+   }
+   for (std::thread& w : workers) { w.join(); }
+
+   while (bounds.size() > 2) {
+      std::vector<size_t> merged;
+      workers.clear();
+      for (size_t i = 0; i + 2 < bounds.size(); i += 2) {
+         workers.emplace_back([&, i] {
+            std::inplace_merge(entries.begin() + bounds[i], entries.begin() + bounds[i + 1], entries.begin() + bounds[i + 2], by_size);
+         });
+         merged.push_back(bounds[i]);
+      }
+      for (std::thread& w : workers) { w.join(); }
+
+      // An odd run out carries over to the next round unchanged
+      if (bounds.size() % 2 == 0) { merged.push_back(bounds[bounds.size() - 2]); }
+      merged.push_back(bounds.back());
+      bounds = std::move(merged);
+   }
+}
+
+/**
+ * @brief Merges sorted entries into the tree, rebuilding it or inserting one by one, whichever is cheaper
+ * 
+ * @param entries New files in ascending order of size. Files already in the tree are ignored.
+ */
+void FileAVL::merge(const std::vector<Entry>& entries) {
+   // M inserts cost O(M log N), a rebuild costs O(N + M)
+   size_t existing = size_, log_n = 1;
+   while ((size_t{1} << log_n) < existing) { log_n++; }
+   if (entries.size() * log_n < existing) {
+      for (const Entry& e : entries) { insert(e.second); }
+      return;
+   }
+
+   std::vector<Entry> all;
+   all.reserve(existing + entries.size());
+   flatten(root_, all);
+   deleteTree();
+
+   // Claim each new file in slots_ now, so repeats (in the tree or within the batch) are dropped
+   size_t middle = all.size();
+   for (const Entry& e : entries) {
+      if (slots_.emplace(e.second, 0).second) { all.push_back(e); }
    }
+   std::inplace_merge(all.begin(), all.begin() + middle, all.end(), [](const Entry& a, const Entry& b) { return a.first < b.first; });
 
-   balance(subroot);
+   std::vector<size_t> buckets;
+   for (size_t i = 0; i < all.size(); i++) {
+      if (i == 0 || all[i].first != all[i - 1].first) { buckets.push_back(i); }
+   }
+   buckets.push_back(all.size());
+
+   root_ = build(all, buckets, 0, buckets.size() - 1);
+   size_ = all.size();
+}
+
+/**
+ * @brief Appends the files of a subtree to out, in-order
+ */
+void FileAVL::flatten(Node* t, std::vector<Entry>& out) const {
+   if (!t) { return; }
+   flatten(t->left_, out);
+   for (File* f : t->files_) { out.emplace_back(t->size_, f); }
+   flatten(t->right_, out);
+}
+
+/**
+ * @brief Builds a height-balanced subtree over the Nodes described by buckets [lo, hi)
+ * 
+ * @param entries All files in ascending order of size
+ * @param buckets The index in entries at which each run of equal sizes begins, followed by entries.size()
+ * @return The root of the subtree
+ */
+Node* FileAVL::build(const std::vector<Entry>& entries, const std::vector<size_t>& buckets, size_t lo, size_t hi) {
+   if (lo >= hi) { return nullptr; }
+
+   size_t mid = lo + (hi - lo) / 2;
+   Node* t = pool_.create(entries[buckets[mid]].second);
+   t->files_.reserve(buckets[mid + 1] - buckets[mid], pool_);
+   for (size_t i = buckets[mid]; i < buckets[mid + 1]; i++) {
+      if (i != buckets[mid]) { t->files_.push_back(entries[i].second, pool_); }
+      slots_[entries[i].second] = i - buckets[mid];
+   }
+
+   t->left_ = build(entries, buckets, lo, mid);
+   t->right_ = build(entries, buckets, mid + 1, hi);
+   update(t);
+   return t;
 }
 
 /**
  * @brief Balance the given Node
  * 
  * @param t The Node to be balanced
+ * @post Rotates Nodes in place, updating heights and subtree aggregates, and sets t to the new subtree root
  */
 void FileAVL::balance(Node* &t) {
    if (t == nullptr) {
       return ;
    }
 
-   if ( height(t->left_) - height(t->right_) > ALLOWED_IMBALANCE) {
-      if ( height( t->left_->left_ ) >= height( t->left_->right_ ) ) {
-         rotateWithLeftChild(t);
+   Node* left = t->left_;
+   Node* right = t->right_;
+   t = avlBalance(ALLOWED_IMBALANCE, t, left, right, [this](Node* n, Node* lt, Node* rt) {
+      n->left_ = lt;
+      n->right_ = rt;
+      update(n);
+      return n;
+   });
+}
+
+/**
+ * @brief Counts and sums the files with size < bound (or <= bound if inclusive)
+ * 
+ * @param total_bytes Receives the total size of the counted files
+ * @return The number of counted files
+ */
+size_t FileAVL::countBelow(size_t bound, bool inclusive, size_t& total_bytes) const {
+   size_t total = 0;
+   total_bytes = 0;
+   Node* t = root_;
+
+   while (t) {
+      if (t->size_ < bound || (inclusive && t->size_ == bound)) {
+         // Everything on the left and this Node counts, keep looking to the right
+         total += count(t->left_) + t->files_.size();
+         total_bytes += bytes(t->left_) + t->size_ * t->files_.size();
+         t = t->right_;
       } else {
-         doubleWithLeftChlid(t);
-      }
-   } else {
-      if (  height( t->right_ ) - height( t->left_ ) > ALLOWED_IMBALANCE ) {
-         if( height( t->right_->right_ ) >= height( t->right_->left_ ) )
-            rotateWithRightChild( t );
-         else {
-            doubleWithRightChild( t );
-         }
+         t = t->left_;
       }
    }
+   return total;
+}
 
-   t->height_ = std::max( height( t->left_ ), height( t->right_ ) ) + 1;
+/**
+ * @brief Counts the files whose sizes are within [min, max] in O(log N), without materializing them
+ * @note Follows the same swapped-bounds convention as query()
+ */
+size_t FileAVL::countInRange(size_t min, size_t max) const {
+   if (min > max) { std::swap(min, max); }
+   size_t unused;
+   return countBelow(max, true, unused) - countBelow(min, false, unused);
 }
 
 /**
- * @brief Performs a rotation on k2 with its left child
+ * @brief Answers many range queries at once. Every answer is counted first in O(log N), so each one is written
+ *    straight into its own slice of a single shared array; the queries are visited in order of their lower bound,
+ *    so neighbouring queries walk the same Nodes while they are still in cache, and large batches are split
+ *    across threads by the number of files they return.
  * 
- * @param k2 The node to be brought down to its left child
- * @post k2 is set to the rotated root (ie. its initial left child); 
- * Both nodes roots are updated to reflect the rotation
+ * @param ranges The [min, max] of each query, following the same swapped-bounds convention as query()
+ * @param threads The most threads to use, or 0 to choose from the hardware and the size of the batch
+ * @return The answer to each query, in the order given
  */
-void FileAVL::rotateWithLeftChild(Node*& k2) {
-   Node* k1 = k2->left_;
-   k2->left_ = k1->right_;
-   k1->right_ = k2;
+RangeBatch FileAVL::queryBatch(const std::vector<std::pair<size_t, size_t>>& ranges, size_t threads) const {
+   RangeBatch batch;
+   batch.offsets_.resize(ranges.size() + 1);
+   for (size_t i = 0; i < ranges.size(); i++) {
+      batch.offsets_[i + 1] = batch.offsets_[i] + countInRange(ranges[i].first, ranges[i].second);
+   }
+   batch.files_.resize(batch.offsets_.back());
+
+   std::vector<size_t> order(ranges.size());
+   for (size_t i = 0; i < order.size(); i++) { order[i] = i; }
+   std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return std::min(ranges[a].first, ranges[a].second) < std::min(ranges[b].first, ranges[b].second);
+   });
+
+   // Fills the answers of order[first, last); the slices never overlap, so no two threads touch the same File*
+   auto answer = [&](size_t first, size_t last) {
+      for (size_t k = first; k < last; k++) {
+         size_t i = order[k];
+         File** out = batch.files_.data() + batch.offsets_[i];
+         forEachInRange(ranges[i].first, ranges[i].second, [&](File* f) { *out++ = f; return true; });
+      }
+   };
+
+   if (threads == 0) {
+      threads = std::min<size_t>(std::thread::hardware_concurrency(), batch.files_.size() / PARALLEL_QUERY_THRESHOLD);
+   }
+   threads = std::min(threads, ranges.size());
+   if (threads < 2) {
+      answer(0, order.size());
+      return batch;
+   }
 
-   k2->height_ = std::max( height( k2->left_ ), height( k2->right_ ) ) + 1;
-   k1->height_ = std::max( height( k1->left_ ), k2->height_ ) + 1;
-   k2 = k1;
+   // Cut the sorted queries into runs returning about the same number of files each
+   std::vector<size_t> bounds{0};
+   size_t returned = 0;
+   for (size_t k = 0; k < order.size() && bounds.size() < threads; k++) {
+      returned += batch.offsets_[order[k] + 1] - batch.offsets_[order[k]];
+      if (returned * threads >= batch.files_.size() * bounds.size()) { bounds.push_back(k + 1); }
+   }
+   bounds.push_back(order.size());
+
+   std::vector<std::thread> workers;
+   for (size_t t = 0; t + 1 < bounds.size(); t++) {
+      workers.emplace_back(answer, bounds[t], bounds[t + 1]);
+   }
+   for (std::thread& w : workers) { w.join(); }
+   return batch;
 }
 
 /**
- * @brief Performs a rotation on k1 with its right child
+ * @brief Sums the sizes (in bytes) of the files whose sizes are within [min, max] in O(log N)
+ * @note Follows the same swapped-bounds convention as query()
+ */
+size_t FileAVL::bytesInRange(size_t min, size_t max) const {
+   if (min > max) { std::swap(min, max); }
+   size_t upper, lower;
+   countBelow(max, true, upper);
+   countBelow(min, false, lower);
+   return upper - lower;
+}
+
+/**
+ * @brief Finds the k-th smallest file by size in O(log N)
  * 
- * @param k1 The node to be brought down to its right child
- * @post k1 is set to the rotated root (ie. its initial right child); 
- * Both nodes roots are updated to reflect the rotation
+ * @param k The zero-based rank of the file to retrieve (eg. select(size() / 2) is a median)
+ * @return A pointer to the k-th smallest file, or nullptr if k >= size().
+ *    Files of equal size are ordered by their position within their Node.
  */
-void FileAVL::rotateWithRightChild(Node*& k1) {
-   Node* k2 = k1->right_;
-   k1->right_ = k2->left_;
-   k2->left_ = k1;
-   k1->height_ = 1 + std::max( height( k1->left_ ), height( k1->right_ ));
-   k2->height_ = 1 + std::max( k1->height_, height(k2->right_) );
-   k1 = k2;
+File* FileAVL::select(size_t k) const {
+   Node* t = root_;
+
+   while (t) {
+      size_t left = count(t->left_);
+      if (k < left) {
+         t = t->left_;
+      } else if (k < left + t->files_.size()) {
+         return t->files_[k - left];
+      } else {
+         k -= left + t->files_.size();
+         t = t->right_;
+      }
+   }
+   return nullptr;
 }
 
 /**
- * @brief Performs a double rotation to fix a left-right imbalance about k3
+ * @brief Counts the files strictly smaller than the given size in O(log N)
  * 
- * @param k3 The parent Node with a left-right imbalance
- * @post Updates heights, sets new root
+ * @return The number of files whose size is < size (ie. the rank a file of that size would be selected at)
  */
-void FileAVL::doubleWithLeftChlid(Node*& k3) {
-   rotateWithRightChild( k3->left_ );
-   rotateWithLeftChild( k3 );
+size_t FileAVL::rank(size_t size) const {
+   size_t unused;
+   return countBelow(size, false, unused);
 }
 
+// =========== RANGE ITERATION  ===========
+
 /**
- * @brief Performs a double rotation to fix a right-left imbalance about k3
+ * @brief Takes an immutable, contiguous snapshot of the tree for read-mostly workloads
  * 
- * @param k3 The parent Node with a right-left imbalance
- * @post Updates heights, sets new root
+ * @return A FrozenFileAVL answering query() exactly as this tree does now. Later changes to the tree are not reflected.
+ */
+FrozenFileAVL FileAVL::freeze() const {
+   return FrozenFileAVL(*this);
+}
+
+/**
+ * @brief Lazily iterates the files whose sizes are within [min, max] in ascending order of size, without allocating
+ * @note Follows the same swapped-bounds convention as query()
+ */
+FileAVL::Range FileAVL::range(size_t min, size_t max) const {
+   if (min > max) { std::swap(min, max); }
+   return Range(root_, min, max);
+}
+
+/**
+ * @brief Constructs the end iterator
+ */
+FileAVL::RangeIterator::RangeIterator() : depth_{0}, index_{0}, max_{0} {}
+
+/**
+ * @brief Constructs an iterator positioned at the first file of root whose size is within [min, max]
+ * @pre min <= max
+ */
+FileAVL::RangeIterator::RangeIterator(Node* root, size_t min, size_t max) : depth_{0}, index_{0}, max_{max} {
+   // Descend towards min, keeping only the Nodes that are >= min (the ones still to be visited)
+   while (root) {
+      if (root->size_ >= min) {
+         stack_[depth_++] = root;
+         root = root->left_;
+      } else {
+         root = root->right_;
+      }
+   }
+   checkBound();
+}
+
+/**
+ * @brief Pushes t and its chain of left children onto the stack
+ */
+void FileAVL::RangeIterator::pushLeft(Node* t) {
+   while (t) {
+      stack_[depth_++] = t;
+      t = t->left_;
+   }
+}
+
+/**
+ * @brief Becomes the end iterator if the Node on top of the stack is past the range
+ */
+void FileAVL::RangeIterator::checkBound() {
+   if (depth_ > 0 && stack_[depth_ - 1]->size_ > max_) { depth_ = 0; }
+}
+
+/**
+ * @brief Advances to the next file in the range, moving on to the in-order successor once a Node is exhausted
+ */
+FileAVL::RangeIterator& FileAVL::RangeIterator::operator++() {
+   Node* top = stack_[depth_ - 1];
+   if (++index_ < top->files_.size()) { return *this; }
+
+   index_ = 0;
+   depth_--;
+   pushLeft(top->right_);
+   checkBound();
+   return *this;
+}
+
+/**
+ * @brief Two iterators are equal if both are at the end or both point at the same file of the same Node
  */
-void FileAVL::doubleWithRightChild(Node*& k3) {
-   rotateWithLeftChild(k3->right_);
-   rotateWithRightChild(k3);
+bool FileAVL::RangeIterator::operator==(const RangeIterator& rhs) const {
+   if (depth_ == 0 || rhs.depth_ == 0) { return depth_ == rhs.depth_; }
+   return stack_[depth_ - 1] == rhs.stack_[rhs.depth_ - 1] && index_ == rhs.index_;
 }
\ No newline at end of file
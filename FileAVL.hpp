@@ -9,40 +9,207 @@
 #include <iterator>
 #include <iostream>
 
+#include "AVLBalance.hpp"
 #include "File.hpp"
+#include "NodePool.hpp"
+#include "FrozenFileAVL.hpp"
 #include <queue>
+#include <unordered_map>
 
-struct Node {
+// Each Node fills exactly one cache line, so visiting a Node costs a single miss
+struct alignas(64) Node {
    size_t size_;    
-   std::vector<File*> files_;
+   FileBucket files_; // The files of this size; a lone file is stored inline
    int height_;   // The height of the Node
+   size_t count_; // The number of files stored in the subtree rooted at this Node
+   size_t bytes_; // The total size (in bytes) of the files stored in the subtree rooted at this Node
    Node *left_;   // A pointer to Node's left child
    Node *right_;  // A pointer to Node's right child
    
    // Parameterized constructor for a Node
-   Node(File* f, Node* lt=nullptr, Node* rt=nullptr) : size_{f->getSize()}, files_{ {f} }, height_{0}, left_{lt}, right_{rt} {}
+   Node(File* f, Node* lt=nullptr, Node* rt=nullptr) : size_{f->getSize()}, files_{f}, height_{0}, count_{1}, bytes_{size_}, left_{lt}, right_{rt} {}
 };
 
+static_assert(sizeof(Node) == 64, "Node should fill exactly one cache line");
+
+/**
+ * @brief The answers to a batch of range queries, packed into one flat array.
+ *    The files of query i are files_[offsets_[i], offsets_[i + 1]), in ascending order of size.
+ */
+struct RangeBatch {
+   std::vector<File*> files_;    // Every answer, back to back in the order the queries were given
+   std::vector<size_t> offsets_; // Where each answer starts, followed by files_.size()
+
+   size_t size() const { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+   FileSpan operator[](size_t i) const { return FileSpan{files_.data() + offsets_[i], files_.data() + offsets_[i + 1]}; }
+};
 
 class FileAVL {
    public:
+   // An upper bound on the height of any AVL tree addressable in memory (~1.44 log2 of 2^64 Nodes)
+   static const int MAX_HEIGHT = 96;
+
+   /**
+    * @brief An in-order, forward iterator over the files whose sizes are within a range.
+    *    Walks the tree lazily using a fixed-size Node stack, so it never allocates.
+    * @note The iterator is invalidated by any modification of the tree.
+    */
+   class RangeIterator {
+      public:
+         using iterator_category = std::forward_iterator_tag;
+         using value_type = File*;
+         using difference_type = std::ptrdiff_t;
+         using pointer = File* const*;
+         using reference = File* const&;
+
+         /**
+          * @brief Constructs the end iterator
+          */
+         RangeIterator();
+
+         /**
+          * @brief Constructs an iterator positioned at the first file of root whose size is within [min, max]
+          * @pre min <= max
+          */
+         RangeIterator(Node* root, size_t min, size_t max);
+
+         reference operator*() const { return stack_[depth_ - 1]->files_[index_]; }
+         pointer operator->() const { return &**this; }
+
+         RangeIterator& operator++();
+         RangeIterator operator++(int) { RangeIterator old = *this; ++*this; return old; }
+
+         bool operator==(const RangeIterator& rhs) const;
+         bool operator!=(const RangeIterator& rhs) const { return !(*this == rhs); }
+
+      private:
+         Node* stack_[MAX_HEIGHT]; // The Nodes whose files (and right subtrees) are still to be visited, innermost last
+         int depth_;               // The number of Nodes on the stack, or 0 once the iterator reaches the end
+         size_t index_;            // The position within the files_ of the Node on top of the stack
+         size_t max_;              // The upper bound of the range
+
+         /**
+          * @brief Pushes t and its chain of left children onto the stack
+          */
+         void pushLeft(Node* t);
+
+         /**
+          * @brief Becomes the end iterator if the Node on top of the stack is past the range
+          */
+         void checkBound();
+   };
+
+   /**
+    * @brief A begin/end pair over the files whose sizes are within a range, for use in range-based for loops
+    */
+   class Range {
+      public:
+         Range(Node* root, size_t min, size_t max) : root_{root}, min_{min}, max_{max} {}
+         RangeIterator begin() const { return RangeIterator(root_, min_, max_); }
+         RangeIterator end() const { return RangeIterator(); }
+
+      private:
+         Node* root_;
+         size_t min_;
+         size_t max_;
+   };
 
     /**
     * @brief Retrieves all files in the FileAVL whose file sizes are within [min, max]
     * 
     * @param min The min value of the file size query range.
     * @param max The max value of the file size query range.
-    * @return std::vector<File*> storing pointers to all files in the tree within the given range.
+    * @return std::vector<File*> storing pointers to all files in the tree within the given range, in ascending order of size.
+    *    Only subtrees that can hold a size in range are visited, so this runs in O(log N + K) for K matches.
     * @note If the query interval is in descending order (ie. the given parameters min >= max), 
             the interval from [max, min] is searched (since max >= min)
     */
    std::vector<File*> query(size_t min, size_t max);
 
+   /**
+    * @brief Lazily iterates the files whose sizes are within [min, max] in ascending order of size, without allocating
+    * @note Follows the same swapped-bounds convention as query()
+    */
+   Range range(size_t min, size_t max) const;
+
+   /**
+    * @brief Calls visit(File*) on each file whose size is within [min, max], in ascending order of size, without allocating
+    * 
+    * @param visit A callable taking a File* and returning a bool; returning false stops the traversal early
+    * @return False if visit stopped the traversal, true otherwise
+    * @note Follows the same swapped-bounds convention as query()
+    */
+   template <typename Visitor>
+   bool forEachInRange(size_t min, size_t max, Visitor&& visit) const {
+      if (min > max) { std::swap(min, max); }
+      return visitRange(root_, min, max, visit);
+   }
+
+   /**
+    * @brief Takes an immutable, contiguous snapshot of the tree for read-mostly workloads
+    * 
+    * @return A FrozenFileAVL answering query() exactly as this tree does now. Later changes to the tree are not reflected.
+    */
+   FrozenFileAVL freeze() const;
+
+   /**
+    * @brief Answers many range queries at once. Every answer is counted first in O(log N), so each one is written
+    *    straight into its own slice of a single shared array; the queries are visited in order of their lower bound,
+    *    so neighbouring queries walk the same Nodes while they are still in cache, and large batches are split
+    *    across threads by the number of files they return.
+    * 
+    * @param ranges The [min, max] of each query, following the same swapped-bounds convention as query()
+    * @param threads The most threads to use, or 0 to choose from the hardware and the size of the batch
+    * @return The answer to each query, in the order given
+    */
+   RangeBatch queryBatch(const std::vector<std::pair<size_t, size_t>>& ranges, size_t threads = 0) const;
+
+   // =========== ORDER STATISTICS  ===========
+
+   /**
+    * @brief Counts the files whose sizes are within [min, max] in O(log N), without materializing them
+    * @note Follows the same swapped-bounds convention as query()
+    */
+   size_t countInRange(size_t min, size_t max) const;
+
+   /**
+    * @brief Sums the sizes (in bytes) of the files whose sizes are within [min, max] in O(log N)
+    * @note Follows the same swapped-bounds convention as query()
+    */
+   size_t bytesInRange(size_t min, size_t max) const;
+
+   /**
+    * @brief Finds the k-th smallest file by size in O(log N)
+    * 
+    * @param k The zero-based rank of the file to retrieve (eg. select(size() / 2) is a median)
+    * @return A pointer to the k-th smallest file, or nullptr if k >= size().
+    *    Files of equal size are ordered by their position within their Node.
+    */
+   File* select(size_t k) const;
+
+   /**
+    * @brief Counts the files strictly smaller than the given size in O(log N)
+    * 
+    * @return The number of files whose size is < size (ie. the rank a file of that size would be selected at)
+    */
+   size_t rank(size_t size) const;
+
    /**
     * @brief Default Constructor: Construct a new AVLtree object
     */
    FileAVL();
 
+   /**
+    * @brief Bulk-load Constructor: Construct a perfectly balanced AVLtree from a range of File*, without any rotations
+    * 
+    * @param first, last The range of files to index. Files of equal size keep their relative order.
+    * @see insertBatch()
+    */
+   template <typename InputIt>
+   FileAVL(InputIt first, InputIt last) : FileAVL() {
+      insertBatch(std::vector<File*>(first, last));
+   }
+
    /**
     * @brief Destroy the AVLtree, deallocating all necessary Nodes
     */
@@ -55,9 +222,49 @@ class FileAVL {
     *    If a duplicate is found, increments the count within the Node of the associated value
     * 
     * @param target The value to be inserted
-    * @post Increases the size of the tree by 1
+    * @post Increases the size of the tree by 1, unless target is already in the tree (in which case nothing happens)
+    * @note Files are tracked by pointer so they can be removed in O(1): inserting the same File* twice is a no-op,
+    *    where it used to add a second entry. Distinct File objects of the same size are still all kept.
     */
    void insert(File* target);   
+
+   /**
+    * @brief Removes a file from the AVL tree while maintaining balance.
+    *    Removing a file from its Node is O(1) regardless of how many files share its size;
+    *    a Node left with no files is deleted from the tree.
+    * 
+    * @param target The file to be removed, which must still have the size it was inserted with
+    * @return True if target was found and removed, false otherwise
+    * @post Decreases the size of the tree by 1 if target was removed
+    */
+   bool remove(File* target);
+
+   /**
+    * @brief Inserts a batch of files at once.
+    *    Small batches (relative to the tree) are inserted one by one; otherwise the batch is sorted by size
+    *    (in parallel for large batches) and merged with the tree, which is then rebuilt bottom-up in O(N + M).
+    * 
+    * @param files The files to be inserted. Files already in the tree (or repeated in the batch) are ignored.
+    * @post Increases the size of the tree by the number of new files
+    */
+   void insertBatch(const std::vector<File*>& files);
+
+   /**
+    * @brief Merges a batch of files that is already sorted by size into the tree, skipping the sort of insertBatch()
+    * 
+    * @param files The files to be inserted, in ascending order of getSize()
+    * @post Increases the size of the tree by the number of new files
+    */
+   void insertSorted(const std::vector<File*>& files);
+
+   /**
+    * @brief Re-keys a file whose size has changed since it was inserted (eg. after its contents were modified)
+    * 
+    * @param target The file whose size changed
+    * @param old_size The size target had when it was inserted (or last updated)
+    * @return True if target was found under old_size and moved to its current size, false otherwise
+    */
+   bool updateSize(File* target, size_t old_size);
    
    /**
     * @brief Determines the height of a given Node 
@@ -84,11 +291,59 @@ class FileAVL {
 
    private:
       static const int ALLOWED_IMBALANCE = 1;
+      NodePool pool_; // Owns every Node (and spilled FileBucket) of the tree
       Node* root_;
       int size_;
+      std::unordered_map<File*, size_t> slots_; // The position of each file within the files_ of its Node
+
+      /**
+       * @brief Internal routine to remove from a subtree, iteratively
+       * 
+       * @param target The file to remove
+       * @param size The size target is stored under
+       * @param subroot The root of the subtree to be removed from
+       * @return True if target was found and removed
+       * @post Set the new root of the subtree
+       */
+      bool remove(File* target, size_t size, Node*& subroot);
+
+      // Batches at least this large are sorted across multiple threads
+      static const size_t PARALLEL_SORT_THRESHOLD = 1 << 16;
+
+      // Batches of queries returning at least this many files per thread are answered across multiple threads
+      static const size_t PARALLEL_QUERY_THRESHOLD = 1 << 16;
+
+      using Entry = std::pair<size_t, File*>; // A file keyed by its size, so sorting never chases File pointers
+
+      /**
+       * @brief Sorts entries by size, keeping files of equal size in their original order
+       */
+      static void sortBySize(std::vector<Entry>& entries);
+
+      /**
+       * @brief Merges sorted entries into the tree, rebuilding it or inserting one by one, whichever is cheaper
+       * 
+       * @param entries New files in ascending order of size. Files already in the tree are ignored.
+       */
+      void merge(const std::vector<Entry>& entries);
+
+      /**
+       * @brief Appends the files of a subtree to out, in-order
+       */
+      void flatten(Node* t, std::vector<Entry>& out) const;
+
+      /**
+       * @brief Builds a height-balanced subtree over the Nodes described by buckets [lo, hi)
+       * 
+       * @param entries All files in ascending order of size
+       * @param buckets The index in entries at which each run of equal sizes begins, followed by entries.size()
+       * @return The root of the subtree
+       */
+      Node* build(const std::vector<Entry>& entries, const std::vector<size_t>& buckets, size_t lo, size_t hi);
 
       /**
-       * @brief Internal routine to insert into a subtree
+       * @brief Internal routine to insert into a subtree, iteratively.
+       *    The links followed on the way down are kept on an explicit path stack and rebalanced on the way back up.
        * 
        * @param target The value to insert
        * @param subroot The root of the subtree to be inserted into
@@ -96,10 +351,35 @@ class FileAVL {
        */
       void insert(File*& target, Node*& subroot);
 
+      /**
+       * @brief Counts and sums the files with size < bound (or <= bound if inclusive)
+       * 
+       * @param total_bytes Receives the total size of the counted files
+       * @return The number of counted files
+       */
+      size_t countBelow(size_t bound, bool inclusive, size_t& total_bytes) const;
+
+      /**
+       * @brief Recomputes the height and subtree aggregates of t from its children
+       * @pre The children of t are up to date
+       */
+      void update(Node* t);
+
+      /**
+       * @brief Returns the number of files in the subtree rooted at n (0 if given a nullptr)
+       */
+      size_t count(Node* n) const;
+
+      /**
+       * @brief Returns the total bytes in the subtree rooted at n (0 if given a nullptr)
+       */
+      size_t bytes(Node* n) const;
+
       /**
        * @brief Balance the given Node
        * 
        * @param t The Node to be balanced
+       * @post Rotates Nodes in place, updating heights and subtree aggregates, and sets t to the new subtree root
        */
       void balance(Node* &t);
 
@@ -114,46 +394,46 @@ class FileAVL {
      */
       void displayInOrder(Node* t) const;
 
-      // =========== ROTATIONS  ===========
-
-      /**
-       * @brief Rotates a Node with its left child
-       * 
-       * @param k2 The parent Node to be rotated
-       * @post Updates heights and sets new root
-       */
-      void rotateWithLeftChild(Node*& k2);
-
       /**
-       * @brief Rotates a Node with its right child
+       * @brief Destroys every Node of the tree by releasing the pool in one go, rather than visiting each Node
        * 
-       * @param k2 The parent Node to be rotated
-       * @post Updates heights and sets new root
+       * @post root_ is nullptr
        */
-      void rotateWithRightChild(Node*& k1);
+      void deleteTree();
 
       /**
-       * @brief Performs a double rotation to fix a left-right imbalance about k3
+       * @brief Appends the files of every Node in [min, max] to result, in-order, skipping subtrees that cannot match.
+       *    Iterative, using an explicit stack bounded by MAX_HEIGHT
        * 
-       * @param k3 The parent Node with a left-right imbalance
-       * @post Updates heights, sets new root
+       * @pre min <= max
        */
-      void doubleWithLeftChlid(Node*& k3);
-
-      /**
-       * @brief Performs a double rotation to fix a right-left imbalance about k3
-       * 
-       * @param k3 The parent Node with a right-left imbalance
-       * @post Updates heights, sets new root
-       */
-      void doubleWithRightChild(Node*& k3);
+      void search(Node*& subroot, size_t min, size_t max, std::vector<File*>& result);
 
       /**
-       * @brief Destroys the given Node and its children
+       * @brief Calls visit on the files of every Node in [min, max], in-order, skipping subtrees that cannot match
        * 
-       * @param t The node to be deleted
+       * @pre min <= max
+       * @return False as soon as visit returns false, true otherwise
        */
-      void deleteTree(Node*& t);
+      template <typename Visitor>
+      static bool visitRange(Node* subroot, size_t min, size_t max, Visitor& visit) {
+         // Same explicit-stack, pruned in-order walk as search()
+         Node* stack[MAX_HEIGHT];
+         int depth = 0;
 
-      void search(Node*& subroot, size_t min, size_t max, std::vector<File*>& result);
+         while (subroot || depth > 0) {
+            while (subroot) {
+               stack[depth++] = subroot;
+               subroot = subroot->size_ > min ? subroot->left_ : nullptr;
+            }
+            subroot = stack[--depth];
+            if (subroot->size_ >= min && subroot->size_ <= max) {
+               for (File* f : subroot->files_) {
+                  if (!visit(f)) { return false; }
+               }
+            }
+            subroot = subroot->size_ < max ? subroot->right_ : nullptr;
+         }
+         return true;
+      }
 };
@@ -0,0 +1,494 @@
+#include "FileIndexLog.hpp"
+#include "File.hpp"
+#include "FileAVL.hpp"
+#include "FileTrie.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Each change is stored as {payload length, payload checksum} followed by the payload {lsn, op, size, new size, name}.
+// Only a resize uses the new size.
+const size_t RECORD_HEADER = 2 * sizeof(uint32_t);
+const size_t PAYLOAD_FIXED = sizeof(uint64_t) + sizeof(uint8_t) + 2 * sizeof(uint64_t);
+
+/**
+ * @brief FNV-1a over length bytes; records are small, so a byte at a time is plenty
+ */
+uint32_t checksum(const char* data, size_t length) {
+   uint32_t h = 2166136261u;
+   for (size_t i = 0; i < length; i++) {
+      h ^= static_cast<unsigned char>(data[i]);
+      h *= 16777619u;
+   }
+   return h;
+}
+
+/**
+ * @brief Throws std::runtime_error describing the last failed system call
+ */
+[[noreturn]] void fail(const std::string& what, const std::string& path) {
+   throw std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+/**
+ * @brief Makes the creation, renaming or removal of entries in directory durable
+ */
+void syncDirectory(const std::string& directory) {
+   int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+   if (fd < 0) { fail("Cannot open", directory); }
+   int synced = ::fsync(fd);
+   ::close(fd);
+   if (synced != 0) { fail("Cannot sync", directory); }
+}
+
+/**
+ * @brief Opens path for appending, creating it if needed
+ */
+int openLog(const std::string& path) {
+   int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+   if (fd < 0) { fail("Cannot open", path); }
+   return fd;
+}
+
+}  // namespace
+
+/**
+ * @brief Opens (or creates) the log in directory, recovering every change that was made durable before
+ *
+ * @param directory Where the snapshot and the log live; created if missing
+ * @param compact_bytes How large the log may grow before it is compacted into a new snapshot
+ * @throws std::runtime_error If the directory, snapshot or log cannot be read or written
+ * @throws InvalidFormatException If the snapshot is corrupt
+ */
+FileIndexLog::FileIndexLog(const std::string& directory, size_t compact_bytes)
+   : snapshot_path_{directory + "/snapshot.fidx"}, log_path_{directory + "/changes.log"},
+     old_log_path_{directory + "/changes.old"}, directory_{directory}, compact_bytes_{compact_bytes},
+     mutex_{}, queued_{}, written_{}, snapshot_{}, overlay_{}, count_{0}, queue_{}, last_lsn_{0}, durable_lsn_{0}, error_{}, compact_error_{}, closing_{false},
+     fd_{-1}, log_bytes_{0}, compact_at_{compact_bytes}, compacting_{false}, compactor_{}, writer_{} {
+   std::filesystem::create_directories(directory_);
+
+   // The snapshot is only mapped and checked here, not loaded: lookups go straight to the mapping
+   if (std::filesystem::exists(snapshot_path_)) {
+      snapshot_ = std::make_shared<const MappedFileIndex>(snapshot_path_);
+      count_ = snapshot_->size();
+      last_lsn_ = snapshot_->sequence();
+   }
+
+   // A log set aside for compaction is older than the current one, so it is replayed first
+   bool interrupted = std::filesystem::exists(old_log_path_);
+   if (interrupted) { replay(old_log_path_, false); }
+   replay(log_path_, true);
+   durable_lsn_ = last_lsn_;
+
+   fd_ = openLog(log_path_);
+   log_bytes_ = std::filesystem::file_size(log_path_);
+   syncDirectory(directory_);
+
+   // The last compaction never finished (or failed): try it again now. If it fails once more, the old log
+   // is kept, and rotate() retries rather than replacing it.
+   if (interrupted) {
+      try {
+         compact(snapshot_, Overlay(overlay_), last_lsn_);
+      } catch (...) {
+         compact_error_ = std::current_exception();
+      }
+   }
+
+   writer_ = std::thread(&FileIndexLog::writeLoop, this);
+}
+
+/**
+ * @brief Writes out every queued change and waits for any compaction in progress, then closes the log
+ */
+FileIndexLog::~FileIndexLog() {
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closing_ = true;
+   }
+   queued_.notify_one();
+   writer_.join();
+   if (compactor_.joinable()) { compactor_.join(); }
+   ::close(fd_);
+}
+
+/**
+ * @brief Applies every intact change in the log at path with an LSN above last_lsn_
+ * @param truncate Whether to cut a torn or corrupt tail off the log, so new changes follow the last good one
+ */
+void FileIndexLog::replay(const std::string& path, bool truncate) {
+   std::ifstream in(path, std::ios::binary);
+   if (!in) {
+      return;
+   }
+   std::string log((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+   size_t pos = 0;
+   while (log.size() - pos >= RECORD_HEADER) {
+      uint32_t length, sum;
+      std::memcpy(&length, log.data() + pos, sizeof(length));
+      std::memcpy(&sum, log.data() + pos + sizeof(length), sizeof(sum));
+      const char* payload = log.data() + pos + RECORD_HEADER;
+
+      // A crash mid-write leaves a short or garbled last record: everything before it is intact
+      if (length < PAYLOAD_FIXED || length > log.size() - pos - RECORD_HEADER || checksum(payload, length) != sum) {
+         break;
+      }
+
+      uint64_t lsn, size, new_size;
+      uint8_t op;
+      std::memcpy(&lsn, payload, sizeof(lsn));
+      std::memcpy(&op, payload + sizeof(lsn), sizeof(op));
+      std::memcpy(&size, payload + sizeof(lsn) + sizeof(op), sizeof(size));
+      std::memcpy(&new_size, payload + sizeof(lsn) + sizeof(op) + sizeof(size), sizeof(new_size));
+      if (lsn > last_lsn_) {
+         apply(static_cast<Op>(op), std::string(payload + PAYLOAD_FIXED, length - PAYLOAD_FIXED), size, new_size);
+         last_lsn_ = lsn;
+      }
+      pos += RECORD_HEADER + length;
+   }
+
+   if (truncate && pos < log.size() && ::truncate(path.c_str(), pos) != 0) {
+      fail("Cannot truncate", path);
+   }
+}
+
+/**
+ * @brief Returns how many files of the given name and size there are, snapshot and changes together
+ */
+int64_t FileIndexLog::countOf(const std::string& name, size_t size) const {
+   int64_t count = 0;
+   if (snapshot_) {
+      // Names are looked up by (case-insensitive) prefix, so keep only exact matches
+      for (const MappedFile& f : snapshot_->getFilesWithPrefix(name)) {
+         count += f.size_ == size && f.name_ == name;
+      }
+   }
+   auto found = overlay_.find({name, size});
+   return found == overlay_.end() ? count : count + found->second;
+}
+
+/**
+ * @brief Applies a change to the in-memory set of files
+ */
+void FileIndexLog::apply(Op op, const std::string& name, size_t size, size_t new_size) {
+   // Adjusts the count of one file, dropping it from the overlay once it matches the snapshot again
+   auto adjust = [&](size_t of, int64_t by) {
+      auto [at, added] = overlay_.try_emplace({name, of}, 0);
+      if ((at->second += by) == 0) { overlay_.erase(at); }
+   };
+   switch (op) {
+      case Op::Add:
+         adjust(size, 1);
+         count_++;
+         break;
+      case Op::Remove:
+         if (countOf(name, size) > 0) {
+            adjust(size, -1);
+            count_--;
+         }
+         break;
+      case Op::Resize:
+         if (countOf(name, size) > 0) {
+            adjust(size, -1);
+            adjust(new_size, 1);
+         }
+         break;
+   }
+}
+
+/**
+ * @brief Applies a change, gives it the next LSN and queues it for the writer thread
+ */
+uint64_t FileIndexLog::append(Op op, const std::string& name, size_t size, size_t new_size) {
+   uint64_t lsn;
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      lsn = ++last_lsn_;
+      apply(op, name, size, new_size);
+
+      uint32_t length = PAYLOAD_FIXED + name.size();
+      uint64_t sizes[2] = {size, new_size};
+      uint8_t code = static_cast<uint8_t>(op);
+      size_t start = queue_.size();
+      queue_.resize(start + RECORD_HEADER + length);
+      char* payload = &queue_[start + RECORD_HEADER];
+      std::memcpy(payload, &lsn, sizeof(lsn));
+      std::memcpy(payload + sizeof(lsn), &code, sizeof(code));
+      std::memcpy(payload + sizeof(lsn) + sizeof(code), sizes, sizeof(sizes));
+      std::memcpy(payload + PAYLOAD_FIXED, name.data(), name.size());
+      uint32_t sum = checksum(payload, length);
+      std::memcpy(&queue_[start], &length, sizeof(length));
+      std::memcpy(&queue_[start + sizeof(length)], &sum, sizeof(sum));
+   }
+   queued_.notify_one();
+   return lsn;
+}
+
+/**
+ * @brief Records that a file was added with the given size
+ * @return The LSN of the change, to pass to sync()
+ */
+uint64_t FileIndexLog::addFile(const std::string& name, size_t size) {
+   return append(Op::Add, name, size, 0);
+}
+
+/**
+ * @brief Records that a file of the given name and size was removed. Has no effect if there is none.
+ * @return The LSN of the change, to pass to sync()
+ */
+uint64_t FileIndexLog::removeFile(const std::string& name, size_t size) {
+   return append(Op::Remove, name, size, 0);
+}
+
+/**
+ * @brief Records that a file's size changed from old_size to new_size. Has no effect if there is no file
+ *    of that name and old_size.
+ * @return The LSN of the change, to pass to sync()
+ */
+uint64_t FileIndexLog::resizeFile(const std::string& name, size_t old_size, size_t new_size) {
+   return append(Op::Resize, name, old_size, new_size);
+}
+
+/**
+ * @brief Blocks until every change up to and including lsn is on disk. A failed compaction does not make
+ *    sync() fail, since the changes are still safe in the log (see compactionError()).
+ * @throws std::runtime_error If the log could not be written
+ */
+void FileIndexLog::sync(uint64_t lsn) {
+   std::unique_lock<std::mutex> lock(mutex_);
+   written_.wait(lock, [&] { return durable_lsn_ >= lsn || error_; });
+   if (error_) { std::rethrow_exception(error_); }
+}
+
+/**
+ * @brief Blocks until every change made so far is on disk
+ * @throws std::runtime_error If the log could not be written
+ */
+void FileIndexLog::sync() {
+   sync(lastLsn());
+}
+
+/**
+ * @brief Runs on writer_: appends queued changes in batches, one fsync per batch, until the log is closed
+ */
+void FileIndexLog::writeLoop() {
+   std::unique_lock<std::mutex> lock(mutex_);
+   while (true) {
+      queued_.wait(lock, [&] { return closing_ || !queue_.empty(); });
+      if (queue_.empty()) {
+         return;
+      }
+
+      // Everything queued while the last fsync ran goes out together
+      std::string batch;
+      batch.swap(queue_);
+      uint64_t upto = last_lsn_;
+      lock.unlock();
+
+      std::exception_ptr failure;
+      try {
+         for (size_t written = 0; written < batch.size();) {
+            ssize_t n = ::write(fd_, batch.data() + written, batch.size() - written);
+            if (n < 0 && errno == EINTR) { continue; }
+            if (n < 0) { fail("Cannot write", log_path_); }
+            written += n;
+         }
+         if (::fdatasync(fd_) != 0) { fail("Cannot sync", log_path_); }
+         log_bytes_ += batch.size();
+         if (log_bytes_ >= compact_at_ && !compacting_) { rotate(); }
+      } catch (...) {
+         failure = std::current_exception();
+      }
+
+      lock.lock();
+      if (failure) {
+         if (!error_) { error_ = failure; }
+      } else {
+         durable_lsn_ = upto;
+      }
+      written_.notify_all();
+   }
+}
+
+/**
+ * @brief Runs on writer_: sets the full log aside, starts a new one, and snapshots the files in the background.
+ *    If a log is still set aside from a failed compaction, it is kept and the snapshot is simply tried again.
+ */
+void FileIndexLog::rotate() {
+   if (compactor_.joinable()) { compactor_.join(); }
+
+   if (std::filesystem::exists(old_log_path_)) {
+      // The old log holds the only copy of its changes until a snapshot includes them, so it must not be
+      // replaced. A snapshot of everything up to now covers both logs; until one succeeds, keep appending
+      // here, and try again only after another compact_bytes_ (rather than after every batch).
+      compact_at_ = log_bytes_ + compact_bytes_;
+   } else {
+      ::close(fd_);
+      fd_ = -1;
+      if (::rename(log_path_.c_str(), old_log_path_.c_str()) != 0) { fail("Cannot rename", log_path_); }
+      fd_ = openLog(log_path_);
+      log_bytes_ = 0;
+      compact_at_ = compact_bytes_;
+      syncDirectory(directory_);
+   }
+
+   // Changes queued but not yet written are in the copy, and will land in the new log too; replay skips them by LSN.
+   // Only the changes are copied: the snapshot is immutable, so the compactor can read it without the lock.
+   std::shared_ptr<const MappedFileIndex> base;
+   Overlay changes;
+   uint64_t lsn;
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      base = snapshot_;
+      changes = overlay_;
+      lsn = last_lsn_;
+   }
+
+   compacting_ = true;
+   compactor_ = std::thread([this, base = std::move(base), changes = std::move(changes), lsn]() {
+      // A failure here leaves every change in a log, so it is reported apart from write failures
+      std::exception_ptr failure;
+      try {
+         compact(base, changes, lsn);
+      } catch (...) {
+         failure = std::current_exception();
+      }
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         compact_error_ = failure;
+      }
+      compacting_ = false;
+   });
+}
+
+/**
+ * @brief Returns every file in base with overlay applied. The names point into base and overlay,
+ *    so are valid only as long as both are.
+ */
+std::vector<MappedFile> FileIndexLog::merge(const MappedFileIndex* base, const Overlay& overlay) {
+   std::map<std::pair<std::string_view, size_t>, int64_t> removed;
+   for (const auto& [file, delta] : overlay) {
+      if (delta < 0) { removed.emplace(std::make_pair(std::string_view(file.first), file.second), -delta); }
+   }
+
+   std::vector<MappedFile> files;
+   if (base) {
+      files.reserve(base->size());
+      for (const MappedFile& f : base->query(0, std::numeric_limits<size_t>::max())) {
+         auto found = removed.empty() ? removed.end() : removed.find({f.name_, f.size_});
+         if (found != removed.end() && found->second > 0) {
+            found->second--;
+         } else {
+            files.push_back(f);
+         }
+      }
+   }
+   for (const auto& [file, delta] : overlay) {
+      for (int64_t i = 0; i < delta; i++) { files.push_back(MappedFile{file.first, file.second}); }
+   }
+   return files;
+}
+
+/**
+ * @brief Writes a snapshot of base with changes applied (the files as of lsn) and serves from it, leaving in memory
+ *    only the changes made since; then deletes the log it replaces
+ */
+void FileIndexLog::compact(std::shared_ptr<const MappedFileIndex> base, const Overlay& changes, uint64_t lsn) {
+   // write() syncs the directory, so the snapshot is durable before the log it replaces goes
+   MappedFileIndex::write(snapshot_path_, merge(base.get(), changes), lsn);
+   auto fresh = std::make_shared<const MappedFileIndex>(snapshot_path_);
+
+   {
+      // The overlay holds changes up to lsn and then some: counts add up, so taking away the ones now in the
+      // snapshot leaves exactly the changes made since
+      std::lock_guard<std::mutex> lock(mutex_);
+      snapshot_ = std::move(fresh);
+      for (const auto& [file, delta] : changes) {
+         auto at = overlay_.try_emplace(file, 0).first;
+         if ((at->second -= delta) == 0) { overlay_.erase(at); }
+      }
+   }
+
+   if (::unlink(old_log_path_.c_str()) != 0 && errno != ENOENT) { fail("Cannot remove", old_log_path_); }
+   syncDirectory(directory_);
+}
+
+/**
+ * @brief Returns the name and size of every file, including changes not yet on disk
+ */
+std::vector<std::pair<std::string, size_t>> FileIndexLog::files() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   std::vector<std::pair<std::string, size_t>> files;
+   files.reserve(count_);
+   for (const MappedFile& f : merge(snapshot_.get(), overlay_)) { files.emplace_back(f.name_, f.size_); }
+   return files;
+}
+
+/**
+ * @brief Makes a File for every file (including changes not yet on disk), appends it to files, and inserts it
+ *    into tree and trie. The index keeps only names and sizes, so each is made by File::fromDisk(name, size):
+ *    its size is known straight away, and its contents are only read (from name, relative to the working
+ *    directory) if asked for. Names File does not accept are skipped.
+ *
+ * @param files Where the Files live; a deque, so that the ones already in tree and trie never move
+ * @return The number of Files made
+ */
+size_t FileIndexLog::rebuild(std::deque<File>& files, FileAVL& tree, FileTrie& trie) const {
+   std::vector<File*> made;
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      made.reserve(count_);
+      for (const MappedFile& f : merge(snapshot_.get(), overlay_)) {
+         if (!File::isValidName(f.name_)) { continue; }
+         files.push_back(File::fromDisk(std::string(f.name_), f.size_));
+         made.push_back(&files.back());
+      }
+   }
+   tree.insertBatch(made);
+   trie.addFiles(made.begin(), made.end());
+   return made.size();
+}
+
+/**
+ * @brief Returns why the latest compaction failed, or nullptr if it succeeded (or none has run yet).
+ *    Until one succeeds, the log set aside for it is kept, and compaction is retried once the log has grown
+ *    by another compact_bytes.
+ */
+std::exception_ptr FileIndexLog::compactionError() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return compact_error_;
+}
+
+/**
+ * @brief Returns the number of files
+ */
+size_t FileIndexLog::size() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return count_;
+}
+
+/**
+ * @brief Returns the LSN of the latest change
+ */
+uint64_t FileIndexLog::lastLsn() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return last_lsn_;
+}
+
+/**
+ * @brief Returns the LSN of the latest change known to be on disk
+ */
+uint64_t FileIndexLog::durableLsn() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return durable_lsn_;
+}
@@ -0,0 +1,202 @@
+/**
+ * @file FileIndexLog.hpp
+ * @brief Defines the interface for FileIndexLog, a write-ahead log of index changes kept beside a MappedFileIndex snapshot
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "MappedFileIndex.hpp"
+
+class File;
+class FileAVL;
+class FileTrie;
+
+/**
+ * @brief Makes changes to the set of indexed files (adds, removes and resizes) durable without rewriting the index.
+ *    A directory holds a MappedFileIndex snapshot and an append-only log of every change since; opening it maps
+ *    the snapshot and replays the log on top, stopping at the first torn or corrupt record. The snapshot is served
+ *    from the mapping: only the changes since are held in memory, as a count per file added or removed.
+ *
+ *    A file is identified by its name and size together, since that is all the index records: files of the same
+ *    name but different sizes are different files, and several files may even share both (eg. in different
+ *    directories), in which case each add and remove counts once.
+ *
+ *    Every change is given a log sequence number (LSN) and queued. A background thread appends whatever has queued
+ *    up in one sequential write and one fsync, so callers waiting in sync() share the cost of each fsync.
+ *    Once the log passes a size threshold it is set aside and a new one started, and a fresh snapshot is written
+ *    in the background; the old log is deleted once the snapshot is safely on disk.
+ */
+class FileIndexLog {
+   public:
+   // The log is compacted into a new snapshot once it reaches this many bytes, unless told otherwise
+   static const size_t DEFAULT_COMPACT_BYTES = 64 << 20;
+
+   /**
+    * @brief Opens (or creates) the log in directory, recovering every change that was made durable before
+    *
+    * @param directory Where the snapshot and the log live; created if missing
+    * @param compact_bytes How large the log may grow before it is compacted into a new snapshot
+    * @throws std::runtime_error If the directory, snapshot or log cannot be read or written
+    * @throws InvalidFormatException If the snapshot is corrupt
+    */
+   explicit FileIndexLog(const std::string& directory, size_t compact_bytes = DEFAULT_COMPACT_BYTES);
+
+   FileIndexLog(const FileIndexLog&) = delete;
+   FileIndexLog& operator=(const FileIndexLog&) = delete;
+
+   /**
+    * @brief Records that a file was added with the given size
+    * @return The LSN of the change, to pass to sync()
+    */
+   uint64_t addFile(const std::string& name, size_t size);
+
+   /**
+    * @brief Records that a file of the given name and size was removed. Has no effect if there is none.
+    * @return The LSN of the change, to pass to sync()
+    */
+   uint64_t removeFile(const std::string& name, size_t size);
+
+   /**
+    * @brief Records that a file's size changed from old_size to new_size. Has no effect if there is no file
+    *    of that name and old_size.
+    * @return The LSN of the change, to pass to sync()
+    */
+   uint64_t resizeFile(const std::string& name, size_t old_size, size_t new_size);
+
+   /**
+    * @brief Blocks until every change up to and including lsn is on disk. A failed compaction does not make
+    *    sync() fail, since the changes are still safe in the log (see compactionError()).
+    * @throws std::runtime_error If the log could not be written
+    */
+   void sync(uint64_t lsn);
+
+   /**
+    * @brief Blocks until every change made so far is on disk
+    * @throws std::runtime_error If the log could not be written
+    */
+   void sync();
+
+   /**
+    * @brief Returns the name and size of every file, including changes not yet on disk
+    */
+   std::vector<std::pair<std::string, size_t>> files() const;
+
+   /**
+    * @brief Makes a File for every file (including changes not yet on disk), appends it to files, and inserts it
+    *    into tree and trie. The index keeps only names and sizes, so each is made by File::fromDisk(name, size):
+    *    its size is known straight away, and its contents are only read (from name, relative to the working
+    *    directory) if asked for. Names File does not accept are skipped.
+    *
+    * @param files Where the Files live; a deque, so that the ones already in tree and trie never move
+    * @return The number of Files made
+    */
+   size_t rebuild(std::deque<File>& files, FileAVL& tree, FileTrie& trie) const;
+
+   /**
+    * @brief Returns the number of files
+    */
+   size_t size() const;
+
+   /**
+    * @brief Returns the LSN of the latest change
+    */
+   uint64_t lastLsn() const;
+
+   /**
+    * @brief Returns the LSN of the latest change known to be on disk
+    */
+   uint64_t durableLsn() const;
+
+   /**
+    * @brief Returns why the latest compaction failed, or nullptr if it succeeded (or none has run yet).
+    *    Until one succeeds, the log set aside for it is kept, and compaction is retried once the log has grown
+    *    by another compact_bytes.
+    */
+   std::exception_ptr compactionError() const;
+
+   /**
+    * @brief Writes out every queued change and waits for any compaction in progress, then closes the log
+    */
+   ~FileIndexLog();
+
+   private:
+      enum class Op : uint8_t { Add = 1, Remove = 2, Resize = 3 };
+
+      // How many more (or fewer) copies of each file there are than in the snapshot; never 0
+      using Overlay = std::map<std::pair<std::string, size_t>, int64_t>;
+
+      std::string snapshot_path_;  // The latest snapshot
+      std::string log_path_;       // The log of changes since (or around) the latest snapshot
+      std::string old_log_path_;   // A log set aside while its changes are compacted into a new snapshot
+      std::string directory_;
+      size_t compact_bytes_;
+
+      mutable std::mutex mutex_;           // Guards everything below, except where noted
+      std::condition_variable queued_;     // Signalled when a change is queued (or the log is closing)
+      std::condition_variable written_;    // Signalled when queued changes reach the disk
+      std::shared_ptr<const MappedFileIndex> snapshot_;  // The latest snapshot, or nullptr if none was written yet
+      Overlay overlay_;                    // Every change since snapshot_
+      size_t count_;                       // The number of files, snapshot and changes together
+      std::string queue_;                  // Encoded changes not yet written
+      uint64_t last_lsn_;
+      uint64_t durable_lsn_;
+      std::exception_ptr error_;           // The first failure of a background write, rethrown by sync()
+      std::exception_ptr compact_error_;   // The failure of the latest compaction, if it failed
+      bool closing_;
+
+      int fd_;                             // The open log; only used by the writer thread once it has started
+      size_t log_bytes_;                   // The size of the open log; likewise
+      size_t compact_at_;                  // The size of the open log at which to compact next; likewise
+      std::atomic<bool> compacting_;
+      std::thread compactor_;
+      std::thread writer_;
+
+      uint64_t append(Op op, const std::string& name, size_t size, size_t new_size);
+      void apply(Op op, const std::string& name, size_t size, size_t new_size);
+
+      /**
+       * @brief Returns how many files of the given name and size there are, snapshot and changes together
+       */
+      int64_t countOf(const std::string& name, size_t size) const;
+
+      /**
+       * @brief Returns every file in base with overlay applied. The names point into base and overlay,
+       *    so are valid only as long as both are.
+       */
+      static std::vector<MappedFile> merge(const MappedFileIndex* base, const Overlay& overlay);
+
+      /**
+       * @brief Applies every intact change in the log at path with an LSN above last_lsn_
+       * @param truncate Whether to cut a torn or corrupt tail off the log, so new changes follow the last good one
+       */
+      void replay(const std::string& path, bool truncate);
+
+      /**
+       * @brief Runs on writer_: appends queued changes in batches, one fsync per batch, until the log is closed
+       */
+      void writeLoop();
+
+      /**
+       * @brief Runs on writer_: sets the full log aside, starts a new one, and snapshots the files in the background.
+       *    If a log is still set aside from a failed compaction, it is kept and the snapshot is simply tried again.
+       */
+      void rotate();
+
+      /**
+       * @brief Writes a snapshot of base with changes applied (the files as of lsn) and serves from it, leaving in memory
+       *    only the changes made since; then deletes the log it replaces
+       */
+      void compact(std::shared_ptr<const MappedFileIndex> base, const Overlay& changes, uint64_t lsn);
+};
@@ -0,0 +1,212 @@
+#include "FileNameIndex.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+// Grams are this many characters long
+const size_t GRAM = 3;
+
+/**
+ * @brief Returns a lower case copy of text
+ */
+std::string lower(const std::string& text) {
+    std::string result = text;
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return std::tolower(c); });
+    return result;
+}
+
+}  // namespace
+
+/**
+ * @brief Default Constructor: Construct a new, empty FileNameIndex
+ */
+FileNameIndex::FileNameIndex() : files_{}, names_{}, ids_{}, grams_{}, extensions_{} {}
+
+/**
+ * @brief Returns the number of files in the index
+ */
+size_t FileNameIndex::size() const {
+    return files_.size();
+}
+
+/**
+ * @brief Packs the three characters starting at text[i] into a single key
+ */
+uint32_t FileNameIndex::gramKey(const std::string& text, size_t i) {
+    return static_cast<unsigned char>(text[i]) << 16 | static_cast<unsigned char>(text[i + 1]) << 8
+           | static_cast<unsigned char>(text[i + 2]);
+}
+
+/**
+ * @brief Adds a file to the index. Adding the same file twice has no effect.
+ *
+ * @param f The file to be added
+ */
+void FileNameIndex::addFile(File* f) {
+    FileId id = static_cast<FileId>(files_.size());
+    if (!ids_.emplace(f, id).second) {
+        return;
+    }
+    files_.push_back(f);
+    names_.push_back(lower(f->getName()));
+    const std::string& name = names_.back();
+
+    //ids only ever grow, so appending keeps every list sorted; a gram repeated within the name is only listed once
+    for (size_t i = 0; i + GRAM <= name.size(); i++) {
+        std::vector<FileId>& list = grams_[gramKey(name, i)];
+        if (list.empty() || list.back() != id) {
+            list.push_back(id);
+        }
+    }
+
+    size_t dot = name.rfind('.');
+    extensions_[dot == std::string::npos ? "" : name.substr(dot + 1)].push_back(id);
+}
+
+/**
+ * @brief Narrows candidates to the files containing every gram of each literal, in ascending FileId order
+ *
+ * @param literals Lower case runs of text that every match must contain
+ * @param candidates Receives the surviving FileIds
+ * @return False if no literal was long enough to prune with (so every file is a candidate)
+ */
+bool FileNameIndex::candidatesFor(const std::vector<std::string>& literals, std::vector<FileId>& candidates) const {
+    std::vector<const std::vector<FileId>*> lists;
+    for (const std::string& literal : literals) {
+        for (size_t i = 0; i + GRAM <= literal.size(); i++) {
+            auto found = grams_.find(gramKey(literal, i));
+            if (found == grams_.end()) {
+                //a gram no file has: nothing can match
+                candidates.clear();
+                return true;
+            }
+            lists.push_back(&found->second);
+        }
+    }
+    if (lists.empty()) {
+        return false;
+    }
+
+    //intersect shortest first, so the running result only ever shrinks from the smallest list
+    std::sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->size() < b->size(); });
+    candidates = *lists.front();
+    std::vector<FileId> narrowed;
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+        narrowed.clear();
+        std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(narrowed));
+        candidates.swap(narrowed);
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the files whose name contains some substring, case insensitive
+ *
+ * @param substring The text to search for
+ * @return Set of all Files whose name contains the substring, or an empty set if none do (or the substring is empty)
+ */
+std::unordered_set<File*> FileNameIndex::getFilesContaining(const std::string& substring) const {
+    std::unordered_set<File*> result;
+    if (substring.empty()) {
+        return result;
+    }
+
+    std::string needle = lower(substring);
+    std::vector<FileId> candidates;
+    bool pruned = candidatesFor({needle}, candidates);
+
+    //grams only say the pieces are there, so confirm them in order (too short to prune: check every name)
+    auto check = [&](FileId id) {
+        if (names_[id].find(needle) != std::string::npos) {
+            result.insert(files_[id]);
+        }
+    };
+    if (pruned) {
+        for (FileId id : candidates) { check(id); }
+    } else {
+        for (FileId id = 0; id < files_.size(); id++) { check(id); }
+    }
+    return result;
+}
+
+/**
+ * @brief Finds the files whose whole name matches a glob pattern, case insensitive
+ *
+ * @param pattern A pattern where '*' matches any run of characters (including none) and '?' matches any one character
+ * @return Set of all Files whose name matches the pattern, or an empty set if none do (or the pattern is empty)
+ */
+std::unordered_set<File*> FileNameIndex::getFilesMatching(const std::string& pattern) const {
+    std::unordered_set<File*> result;
+    if (pattern.empty()) {
+        return result;
+    }
+    std::string glob = lower(pattern);
+
+    //"*.ext": names have exactly one period (File guarantees it), so the extension index is the whole answer
+    if (glob.size() > 2 && glob[0] == '*' && glob[1] == '.' && glob.find_first_of("*?.", 2) == std::string::npos) {
+        auto found = extensions_.find(glob.substr(2));
+        if (found != extensions_.end()) {
+            for (FileId id : found->second) { result.insert(files_[id]); }
+        }
+        return result;
+    }
+
+    //every run of plain characters between wildcards has to appear in a matching name
+    std::vector<std::string> literals(1);
+    for (char c : glob) {
+        if (c == '*' || c == '?') {
+            literals.emplace_back();
+        } else {
+            literals.back() += c;
+        }
+    }
+
+    std::vector<FileId> candidates;
+    bool pruned = candidatesFor(literals, candidates);
+
+    auto check = [&](FileId id) {
+        if (globMatch(glob, names_[id])) {
+            result.insert(files_[id]);
+        }
+    };
+    if (pruned) {
+        for (FileId id : candidates) { check(id); }
+    } else {
+        for (FileId id = 0; id < files_.size(); id++) { check(id); }
+    }
+    return result;
+}
+
+/**
+ * @brief Checks whether a whole name matches a glob pattern, case sensitive.
+ *      Runs in O(|name| * |pattern|) at worst by only ever backtracking to the most recent '*'.
+ */
+bool FileNameIndex::globMatch(const std::string& pattern, const std::string& name) {
+    size_t p = 0, n = 0;
+    size_t star = std::string::npos, resume = 0;
+
+    while (n < name.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+            p++;
+            n++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            //let the star match nothing for now, remembering where to come back to
+            star = p++;
+            resume = n;
+        } else if (star != std::string::npos) {
+            //mismatch: let the last star swallow one more character and retry
+            p = star + 1;
+            n = ++resume;
+        } else {
+            return false;
+        }
+    }
+
+    //only trailing stars may be left over
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
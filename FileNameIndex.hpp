@@ -0,0 +1,83 @@
+/**
+ * @file FileNameIndex.hpp
+ * @brief Defines the interface for FileNameIndex, a substring and glob search index over file names
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "File.hpp"
+
+/**
+ * @brief Answers substring ("report") and glob ("*report*", "img??.jpg", "*.log") queries over file names,
+ *      case insensitive like FileTrie. Every name is broken into overlapping 3-character grams, each mapping
+ *      to the sorted list of files containing it; a query intersects the lists of the grams it must contain and
+ *      only checks the surviving candidates. Extensions get their own index, since "*.ext" is the common case.
+ */
+class FileNameIndex {
+    public:
+        /**
+         * @brief Default Constructor: Construct a new, empty FileNameIndex
+         */
+        FileNameIndex();
+
+        /**
+         * @brief Adds a file to the index. Adding the same file twice has no effect.
+         *
+         * @param f The file to be added
+         */
+        void addFile(File* f);
+
+        /**
+         * @brief Finds the files whose name contains some substring, case insensitive
+         *
+         * @param substring The text to search for
+         * @return Set of all Files whose name contains the substring, or an empty set if none do (or the substring is empty)
+         */
+        std::unordered_set<File*> getFilesContaining(const std::string& substring) const;
+
+        /**
+         * @brief Finds the files whose whole name matches a glob pattern, case insensitive
+         *
+         * @param pattern A pattern where '*' matches any run of characters (including none) and '?' matches any one character
+         * @return Set of all Files whose name matches the pattern, or an empty set if none do (or the pattern is empty)
+         */
+        std::unordered_set<File*> getFilesMatching(const std::string& pattern) const;
+
+        /**
+         * @brief Returns the number of files in the index
+         */
+        size_t size() const;
+
+        /**
+         * @brief Checks whether a whole name matches a glob pattern, case sensitive.
+         *      Runs in O(|name| * |pattern|) at worst by only ever backtracking to the most recent '*'.
+         */
+        static bool globMatch(const std::string& pattern, const std::string& name);
+
+    private:
+        using FileId = uint32_t;
+
+        std::vector<File*> files_;                                          // Every file, indexed by its FileId
+        std::vector<std::string> names_;                                    // The lower case name of every file
+        std::unordered_map<File*, FileId> ids_;                             // The FileId of every file
+        std::unordered_map<uint32_t, std::vector<FileId>> grams_;           // The files containing each 3-character gram, ascending
+        std::unordered_map<std::string, std::vector<FileId>> extensions_;   // The files with each (lower case) extension, ascending
+
+        /**
+         * @brief Packs the three characters starting at text[i] into a single key
+         */
+        static uint32_t gramKey(const std::string& text, size_t i);
+
+        /**
+         * @brief Narrows candidates to the files containing every gram of each literal, in ascending FileId order
+         *
+         * @param literals Lower case runs of text that every match must contain
+         * @param candidates Receives the surviving FileIds
+         * @return False if no literal was long enough to prune with (so every file is a candidate)
+         */
+        bool candidatesFor(const std::vector<std::string>& literals, std::vector<FileId>& candidates) const;
+};
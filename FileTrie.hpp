@@ -7,8 +7,11 @@
 #pragma once
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <cctype>
 #include <string>
+#include <string_view>
+#include <algorithm>
 #include <iostream>
 #include <functional>
 #include "File.hpp"
@@ -16,20 +19,87 @@
 struct FileTrieNode {   
     char stored;
 
-    std::unordered_set<File*> matching;
+    size_t count;                 // The number of files whose name passes through (or ends at) this node
+    size_t max_size;              // The largest size (as of insertion) of any file whose name passes through this node
+    std::vector<File*> files;     // Only the files whose name ends exactly at this node
     std::unordered_map<char, FileTrieNode*> next;
 
-    FileTrieNode(const char& c = ' ', File* to_add = nullptr) : stored{c}, matching{}, next{} {
-        if (to_add) { matching.insert(to_add); }
-    }
+    FileTrieNode(const char& c = ' ') : stored{c}, count{0}, max_size{0}, files{}, next{} {}
 };
 
 class FileTrie {
+    public:
+        /**
+         * @brief A forward iterator over the files stored in a subtree of the FileTrie, walked lazily (depth first)
+         * @note The iterator is invalidated by any addFile()
+         */
+        class PrefixIterator {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = File*;
+                using difference_type = std::ptrdiff_t;
+                using pointer = File* const*;
+                using reference = File* const&;
+
+                /**
+                 * @brief Constructs the end iterator
+                 */
+                PrefixIterator();
+
+                /**
+                 * @brief Constructs an iterator positioned at the first file stored in the subtree rooted at subroot
+                 */
+                explicit PrefixIterator(const FileTrieNode* subroot);
+
+                reference operator*() const { return stack.back().node->files[index]; }
+                pointer operator->() const { return &**this; }
+
+                PrefixIterator& operator++();
+                PrefixIterator operator++(int) { PrefixIterator old = *this; ++*this; return old; }
+
+                bool operator==(const PrefixIterator& rhs) const;
+                bool operator!=(const PrefixIterator& rhs) const { return !(*this == rhs); }
+
+            private:
+                // A node on the current path, and the next of its children still to be visited
+                struct Frame {
+                    const FileTrieNode* node;
+                    std::unordered_map<char, FileTrieNode*>::const_iterator child;
+                };
+                std::vector<Frame> stack;   // The path from the subtree root to the current node, empty at the end
+                size_t index;               // The position within the files of the current node
+
+                /**
+                 * @brief Moves forward (depth first) until index refers to a file, or the walk is over
+                 */
+                void settle();
+        };
+
+        /**
+         * @brief A read-only view of the files that begin with some prefix. Nothing is copied:
+         *      size() is O(1) and the files are found lazily while iterating.
+         * @note The view is invalidated by any addFile()
+         */
+        class PrefixView {
+            public:
+                explicit PrefixView(const FileTrieNode* subroot) : subroot{subroot} {}
+                PrefixIterator begin() const { return subroot ? PrefixIterator(subroot) : PrefixIterator(); }
+                PrefixIterator end() const { return PrefixIterator(); }
+                size_t size() const { return subroot ? subroot->count : 0; }
+                bool empty() const { return size() == 0; }
+
+            private:
+                const FileTrieNode* subroot;  // The node reached by the prefix, or nullptr if nothing matches
+        };
+
     private:
         FileTrieNode* head;
         void deleteTrie(FileTrieNode* sub_head);
-        void addHelper(FileTrieNode* head, const std::string& fileName, File* f);
-        void searchHelper(const std::string& prefix, FileTrieNode* subroot, std::unordered_set<File*>& result) const;
+        bool addHelper(FileTrieNode* head, std::string_view fileName, File* f);
+        FileTrieNode* findPrefix(const std::string& prefix) const;
+        void collect(const FileTrieNode* subroot, std::unordered_set<File*>& result) const;
+        void fuzzyHelper(const FileTrieNode* node, char c, const std::string& query, size_t max_distance,
+                         std::vector<std::vector<size_t>>& rows, size_t depth, std::vector<const FileTrieNode*>& matches) const;
     public:
         /**
          * @brief Default Constructor: Construct a new FileTrie object
@@ -43,6 +113,26 @@ class FileTrie {
          */
         void addFile(File* f);
 
+        /**
+         * @brief Adds a batch of files into FileTrie object, case insensitive.
+         *      The batch is sorted by name first, so consecutive inserts share most of their path and stay in cache.
+         * 
+         * @param first, last The range of File* to be added
+         */
+        template <typename InputIt>
+        void addFiles(InputIt first, InputIt last) {
+            std::vector<File*> batch(first, last);
+            std::sort(batch.begin(), batch.end(), [](File* a, File* b) {
+                const std::string& lhs = a->getName();
+                const std::string& rhs = b->getName();
+                return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                    [](unsigned char x, unsigned char y) { return std::tolower(x) < std::tolower(y); });
+            });
+            for (File* f : batch) {
+                addFile(f);
+            }
+        }
+
         /**
          * @brief Searches the FileTrie for some prefix and returns a set of Files that begin with that prefix.
          *      If no match is found, then an empty set is returned.
@@ -52,6 +142,57 @@ class FileTrie {
          */
         std::unordered_set<File*> getFilesWithPrefix(const std::string& prefix) const;
 
+        /**
+         * @brief Looks up some prefix without copying any files, case insensitive
+         * 
+         * @param prefix Prefix that is being searched for
+         * @return A view over all Files with the same prefix; empty if no match is found (or the prefix is empty)
+         */
+        PrefixView viewFilesWithPrefix(const std::string& prefix) const;
+
+        /**
+         * @brief Counts the Files that begin with some prefix in O(prefix length), case insensitive
+         * 
+         * @param prefix Prefix that is being searched for
+         * @return The number of Files with the same prefix, or 0 if no match is found (or the prefix is empty)
+         */
+        size_t countWithPrefix(const std::string& prefix) const;
+
+        /**
+         * @brief Finds the k largest Files that begin with some prefix, case insensitive.
+         *      Runs best-first using the largest size stored at each node, so the work is proportional
+         *      to the prefix length and k rather than to the number of matches.
+         * 
+         * @param prefix Prefix that is being searched for
+         * @param k The maximum number of Files to return
+         * @return Up to k Files with the same prefix, largest first
+         * @note Sizes are taken as of addFile(); a File whose contents change afterwards may be ranked by its old size
+         */
+        std::vector<File*> topKWithPrefix(const std::string& prefix, size_t k) const;
+
+        /**
+         * @brief Finds the k highest-scoring Files that begin with some prefix, case insensitive.
+         *      An arbitrary score cannot be bounded per node, so every match is scored once, keeping only the best k.
+         * 
+         * @param prefix Prefix that is being searched for
+         * @param k The maximum number of Files to return
+         * @param score Ranks a File (eg. by recency or access frequency); higher is better
+         * @return Up to k Files with the same prefix, highest score first
+         */
+        std::vector<File*> topKWithPrefix(const std::string& prefix, size_t k, const std::function<double(const File*)>& score) const;
+
+        /**
+         * @brief Finds the Files that begin with something within max_distance edits (insertions, deletions or
+         *      substitutions) of some prefix, case insensitive. Walks the FileTrie keeping one row of the edit distance
+         *      table per node, and skips a subtree as soon as no entry of its row is within max_distance.
+         * 
+         * @param prefix Prefix that is being searched for, possibly misspelt
+         * @param max_distance The most edits allowed between the prefix and the start of a name
+         * @return Set of all Files whose name starts within max_distance edits of the prefix, or an empty set if
+         *      none do (or the prefix is empty)
+         */
+        std::unordered_set<File*> getFilesWithFuzzyPrefix(const std::string& prefix, size_t max_distance) const;
+
         /**
          * @brief Destroy the FileTrie, deallocating all necessary FileTrieNodes
          */
@@ -0,0 +1,100 @@
+#include "FrozenFileAVL.hpp"
+#include "FileAVL.hpp"
+
+#include <limits>
+
+/**
+ * @brief Constructs an empty snapshot
+ */
+FrozenFileAVL::FrozenFileAVL() : files_{}, keys_(1), first_(1) {}
+
+/**
+ * @brief Snapshots the current contents of tree
+ */
+FrozenFileAVL::FrozenFileAVL(const FileAVL& tree) : FrozenFileAVL() {
+   std::vector<size_t> sizes, offsets;
+   files_.reserve(tree.size());
+
+   tree.forEachInRange(0, std::numeric_limits<size_t>::max(), [&](File* f) {
+      if (sizes.empty() || sizes.back() != f->getSize()) {
+         sizes.push_back(f->getSize());
+         offsets.push_back(files_.size());
+      }
+      files_.push_back(f);
+      return true;
+   });
+
+   keys_.resize(sizes.size() + 1);
+   first_.resize(sizes.size() + 1);
+   size_t next = 0;
+   layout(sizes, offsets, next, 1);
+}
+
+/**
+ * @brief Fills keys_ and first_ in Eytzinger order by an in-order walk of the implicit tree
+ *
+ * @param sizes The unique sizes in ascending order
+ * @param offsets The offset in files_ of the first file of each size
+ * @param next The next position of sizes to place
+ * @param k The current Eytzinger index
+ */
+void FrozenFileAVL::layout(const std::vector<size_t>& sizes, const std::vector<size_t>& offsets, size_t& next, size_t k) {
+   if (k >= keys_.size()) { return; }
+   layout(sizes, offsets, next, 2 * k);
+   keys_[k] = sizes[next];
+   first_[k] = offsets[next];
+   next++;
+   layout(sizes, offsets, next, 2 * k + 1);
+}
+
+/**
+ * @brief Returns the offset in files_ of the first file whose size is >= size (or files_.size() if none)
+ */
+size_t FrozenFileAVL::lowerBound(size_t size) const {
+   const size_t n = keys_.size() - 1;
+   const size_t* keys = keys_.data();
+   size_t k = 1;
+
+   while (k <= n) {
+      // The 16 descendants four levels down share two cache lines, so fetch them ahead of time
+      __builtin_prefetch(keys + 16 * k);
+      k = 2 * k + (keys[k] < size);
+   }
+
+   // Undo the trailing right turns (and the final left turn) to recover the last Node that was >= size
+   k >>= __builtin_ffsll(~k);
+   return k == 0 ? files_.size() : first_[k];
+}
+
+/**
+ * @brief Finds the files whose sizes are within [min, max] without copying them
+ *
+ * @return A view into the snapshot, valid for as long as the snapshot is
+ * @note Follows the same swapped-bounds convention as query()
+ */
+FileSpan FrozenFileAVL::range(size_t min, size_t max) const {
+   if (min > max) { std::swap(min, max); }
+
+   size_t begin = lowerBound(min);
+   size_t end = max == std::numeric_limits<size_t>::max() ? files_.size() : lowerBound(max + 1);
+   return FileSpan{files_.data() + begin, files_.data() + end};
+}
+
+/**
+ * @brief Retrieves all files in the snapshot whose file sizes are within [min, max]
+ *
+ * @return std::vector<File*> storing pointers to all files within the given range, in ascending order of size.
+ * @note If the query interval is in descending order (ie. the given parameters min >= max),
+         the interval from [max, min] is searched (since max >= min)
+ */
+std::vector<File*> FrozenFileAVL::query(size_t min, size_t max) const {
+   FileSpan span = range(min, max);
+   return std::vector<File*>(span.begin(), span.end());
+}
+
+/**
+ * @brief Returns the number of files in the snapshot
+ */
+size_t FrozenFileAVL::size() const {
+   return files_.size();
+}
@@ -0,0 +1,85 @@
+/**
+ * @file FrozenFileAVL.hpp
+ * @brief Defines the interface for FrozenFileAVL, an immutable read-optimized snapshot of a FileAVL
+ */
+
+#pragma once
+#include <cstddef>
+#include <vector>
+
+class File;
+class FileAVL;
+
+/**
+ * @brief A contiguous run of File* within a FrozenFileAVL, in ascending order of size
+ */
+struct FileSpan {
+   File* const* begin_;
+   File* const* end_;
+
+   File* const* begin() const { return begin_; }
+   File* const* end() const { return end_; }
+   size_t size() const { return end_ - begin_; }
+   bool empty() const { return begin_ == end_; }
+};
+
+/**
+ * @brief An immutable snapshot of a FileAVL laid out for range scans.
+ *    All files live in one flat array sorted by size; the unique sizes are kept in Eytzinger (BFS) order,
+ *    each paired with the offset of its first file, so a lookup is a branch-free, cache-friendly descent
+ *    and a range query is two lookups delimiting a contiguous span.
+ */
+class FrozenFileAVL {
+   public:
+      /**
+       * @brief Constructs an empty snapshot
+       */
+      FrozenFileAVL();
+
+      /**
+       * @brief Snapshots the current contents of tree
+       */
+      explicit FrozenFileAVL(const FileAVL& tree);
+
+      /**
+       * @brief Retrieves all files in the snapshot whose file sizes are within [min, max]
+       *
+       * @return std::vector<File*> storing pointers to all files within the given range, in ascending order of size.
+       * @note If the query interval is in descending order (ie. the given parameters min >= max),
+               the interval from [max, min] is searched (since max >= min)
+       */
+      std::vector<File*> query(size_t min, size_t max) const;
+
+      /**
+       * @brief Finds the files whose sizes are within [min, max] without copying them
+       *
+       * @return A view into the snapshot, valid for as long as the snapshot is
+       * @note Follows the same swapped-bounds convention as query()
+       */
+      FileSpan range(size_t min, size_t max) const;
+
+      /**
+       * @brief Returns the number of files in the snapshot
+       */
+      size_t size() const;
+
+   private:
+      std::vector<File*> files_;  // Every file, in ascending order of size
+      std::vector<size_t> keys_;  // The unique sizes in Eytzinger order, 1-indexed (keys_[0] is unused)
+      std::vector<size_t> first_; // first_[k] is the offset in files_ of the first file of size keys_[k]
+
+      /**
+       * @brief Fills keys_ and first_ in Eytzinger order by an in-order walk of the implicit tree
+       *
+       * @param sizes The unique sizes in ascending order
+       * @param offsets The offset in files_ of the first file of each size
+       * @param next The next position of sizes to place
+       * @param k The current Eytzinger index
+       */
+      void layout(const std::vector<size_t>& sizes, const std::vector<size_t>& offsets, size_t& next, size_t k);
+
+      /**
+       * @brief Returns the offset in files_ of the first file whose size is >= size (or files_.size() if none)
+       */
+      size_t lowerBound(size_t size) const;
+};
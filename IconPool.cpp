@@ -0,0 +1,108 @@
+#include "IconPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief The interned icons, found by a hash of their pixels. Each is held weakly, so the pool never keeps an icon alive.
+ */
+struct Pool {
+   std::mutex mutex_;
+   std::unordered_map<uint64_t, std::vector<std::weak_ptr<const IconPool::Icon>>> icons_;
+   size_t live_ = 0;
+};
+
+/**
+ * @brief The one pool. It is never destroyed, so Files destroyed during program exit can still release their icons.
+ */
+Pool& pool() {
+   static Pool* instance = new Pool();
+   return *instance;
+}
+
+/**
+ * @brief FNV-1a over the pixels of an icon
+ */
+uint64_t hash(const IconPool::Icon& icon) {
+   uint64_t h = 14695981039346656037ull;
+   for (uint8_t pixel : icon) {
+      h ^= pixel;
+      h *= 1099511628211ull;
+   }
+   return h;
+}
+
+}  // namespace
+
+/**
+ * @brief Returns the shared copy of the icon with the given pixels, adding it to the pool if it is new
+ *
+ * @param pixels An array of ICON_DIM 8-bit pixels, or nullptr for no icon (in which case nullptr is returned)
+ */
+IconPool::Handle IconPool::intern(const uint8_t* pixels) {
+   if (!pixels) {
+      return nullptr;
+   }
+   Icon icon;
+   std::memcpy(icon.data(), pixels, ICON_DIM);
+   uint64_t key = hash(icon);
+
+   Pool& p = pool();
+   std::lock_guard<std::mutex> lock(p.mutex_);
+   std::vector<std::weak_ptr<const Icon>>& bucket = p.icons_[key];
+   for (const std::weak_ptr<const Icon>& candidate : bucket) {
+      Handle existing = candidate.lock();
+      if (existing && *existing == icon) {
+         return existing;
+      }
+   }
+
+   // The last Handle to go takes the icon back out of the pool (unless it was replaced in the meantime)
+   const Icon* stored = new Icon(icon);
+   Handle handle(stored, [key](const Icon* dying) {
+      Pool& p = pool();
+      {
+         std::lock_guard<std::mutex> lock(p.mutex_);
+         auto found = p.icons_.find(key);
+         if (found != p.icons_.end()) {
+            std::vector<std::weak_ptr<const Icon>>& bucket = found->second;
+            bucket.erase(std::remove_if(bucket.begin(), bucket.end(),
+               [](const std::weak_ptr<const Icon>& w) { return w.expired(); }), bucket.end());
+            if (bucket.empty()) { p.icons_.erase(found); }
+         }
+         p.live_--;
+      }
+      delete dying;
+   });
+   bucket.push_back(handle);
+   p.live_++;
+   return handle;
+}
+
+/**
+ * @brief Returns the shared copy of the icon with the given pixels, each of which is an 8-bit value held in an int
+ *
+ * @param pixels An array of ICON_DIM pixels, or nullptr for no icon (in which case nullptr is returned)
+ */
+IconPool::Handle IconPool::intern(const int* pixels) {
+   if (!pixels) {
+      return nullptr;
+   }
+   uint8_t narrowed[ICON_DIM];
+   std::transform(pixels, pixels + ICON_DIM, narrowed, [](int pixel) { return static_cast<uint8_t>(pixel); });
+   return intern(narrowed);
+}
+
+/**
+ * @brief Returns the number of distinct icons currently in use
+ */
+size_t IconPool::distinct() {
+   Pool& p = pool();
+   std::lock_guard<std::mutex> lock(p.mutex_);
+   return p.live_;
+}
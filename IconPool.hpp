@@ -0,0 +1,43 @@
+/**
+ * @file IconPool.hpp
+ * @brief Defines IconPool, which stores each distinct file icon once and shares it between every File using it
+ */
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief Interns icons by their pixels: asking for an icon equal to one that is already in use returns the same,
+ *    reference-counted copy, so memory grows with the number of distinct icons rather than the number of files.
+ *    An icon is freed once the last File using it lets go. Safe to use from any thread.
+ */
+class IconPool {
+   public:
+   static const size_t ICON_DIM = 256; // Representing a 16 x 16 bitmap
+
+   // The 8-bit pixels of an icon. Icons are never modified once interned.
+   using Icon = std::array<uint8_t, ICON_DIM>;
+   using Handle = std::shared_ptr<const Icon>;
+
+   /**
+    * @brief Returns the shared copy of the icon with the given pixels, adding it to the pool if it is new
+    *
+    * @param pixels An array of ICON_DIM 8-bit pixels, or nullptr for no icon (in which case nullptr is returned)
+    */
+   static Handle intern(const uint8_t* pixels);
+
+   /**
+    * @brief Returns the shared copy of the icon with the given pixels, each of which is an 8-bit value held in an int
+    *
+    * @param pixels An array of ICON_DIM pixels, or nullptr for no icon (in which case nullptr is returned)
+    */
+   static Handle intern(const int* pixels);
+
+   /**
+    * @brief Returns the number of distinct icons currently in use
+    */
+   static size_t distinct();
+};
@@ -0,0 +1,338 @@
+#include "MappedFileIndex.hpp"
+#include "FileAVL.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Identifies an index file, whatever its version
+static const char MAGIC[8] = {'F', 'I', 'L', 'E', 'I', 'D', 'X', '\0'};
+
+struct MappedFileIndex::Header {
+   char magic_[8];
+   uint32_t version_;
+   uint32_t header_size_;
+   uint64_t sequence_;
+   uint64_t count_;              // The number of records
+   uint64_t records_offset_;
+   uint64_t by_name_offset_;
+   uint64_t names_offset_;
+   uint64_t names_length_;
+   uint64_t payload_checksum_;   // Covers every byte after the header
+   uint64_t header_checksum_;    // Covers every byte of the header before this field
+};
+
+struct MappedFileIndex::Record {
+   uint64_t size_;
+   uint64_t name_offset_;   // Relative to the start of the names
+   uint32_t name_length_;
+   uint32_t unused_;
+};
+
+namespace {
+
+/**
+ * @brief Hashes length bytes a word at a time; any change to the bytes changes the result with overwhelming likelihood
+ */
+uint64_t checksum(const char* data, size_t length) {
+   uint64_t h = 0x9E3779B97F4A7C15ull ^ length;
+   auto mix = [&h](uint64_t word) {
+      h ^= word;
+      h *= 0xFF51AFD7ED558CCDull;
+      h ^= h >> 32;
+   };
+
+   size_t i = 0;
+   for (; i + 8 <= length; i += 8) {
+      uint64_t word;
+      std::memcpy(&word, data + i, 8);
+      mix(word);
+   }
+   if (i < length) {
+      uint64_t word = 0;
+      std::memcpy(&word, data + i, length - i);
+      mix(word);
+   }
+   return h;
+}
+
+/**
+ * @brief Compares two names a byte at a time, ignoring case
+ */
+bool foldedLess(std::string_view a, std::string_view b) {
+   return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+      [](unsigned char x, unsigned char y) { return std::tolower(x) < std::tolower(y); });
+}
+
+/**
+ * @brief Throws std::runtime_error describing the last failed system call
+ */
+[[noreturn]] void fail(const std::string& what, const std::string& path) {
+   throw std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+}  // namespace
+
+/**
+ * @brief Writes an index of every file in tree to path. The index is written beside path and renamed over it
+ *    once it is safely on disk (the directory too), so a crash never leaves a half-written index behind, and
+ *    once write() returns the new index is there to stay.
+ *
+ * @param sequence A number stored in the header for the caller to identify this index by (eg. the last change it includes)
+ * @throws std::runtime_error If the file cannot be written
+ */
+void MappedFileIndex::write(const std::string& path, const FileAVL& tree, uint64_t sequence) {
+   std::vector<MappedFile> files;
+   files.reserve(tree.size());
+   tree.forEachInRange(0, std::numeric_limits<size_t>::max(), [&](File* f) {
+      files.push_back(MappedFile{f->getName(), f->getSize()});
+      return true;
+   });
+   write(path, std::move(files), sequence);
+}
+
+/**
+ * @brief Writes an index of the given names and sizes to path, the same way as above
+ *
+ * @param files The files to index, in any order; the names only have to stay valid until write() returns
+ * @throws std::runtime_error If the file cannot be written
+ */
+void MappedFileIndex::write(const std::string& path, std::vector<MappedFile> files, uint64_t sequence) {
+   static_assert(sizeof(Header) == 80, "the header layout is part of the file format");
+   static_assert(sizeof(Record) == 24, "the record layout is part of the file format");
+
+   if (files.size() > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error("Too many files for an index: " + std::to_string(files.size()));
+   }
+   // Already sorted when they come from a FileAVL, which stable_sort notices in a single pass
+   std::stable_sort(files.begin(), files.end(), [](const MappedFile& a, const MappedFile& b) { return a.size_ < b.size_; });
+
+   std::vector<Record> records;
+   std::string names;
+   records.reserve(files.size());
+   for (const MappedFile& f : files) {
+      records.push_back(Record{f.size_, names.size(), static_cast<uint32_t>(f.name_.size()), 0});
+      names += f.name_;
+   }
+
+   std::vector<uint32_t> by_name(records.size());
+   for (uint32_t i = 0; i < by_name.size(); i++) { by_name[i] = i; }
+   auto name = [&](uint32_t i) { return std::string_view(names).substr(records[i].name_offset_, records[i].name_length_); };
+   std::sort(by_name.begin(), by_name.end(), [&](uint32_t a, uint32_t b) { return foldedLess(name(a), name(b)); });
+
+   // Lay the sections out back to back, each aligned for its own type
+   Header header{};
+   std::memcpy(header.magic_, MAGIC, sizeof(MAGIC));
+   header.version_ = VERSION;
+   header.header_size_ = sizeof(Header);
+   header.sequence_ = sequence;
+   header.count_ = records.size();
+   header.records_offset_ = sizeof(Header);
+   header.by_name_offset_ = header.records_offset_ + records.size() * sizeof(Record);
+   header.names_offset_ = header.by_name_offset_ + by_name.size() * sizeof(uint32_t);
+   header.names_length_ = names.size();
+
+   std::vector<char> image(header.names_offset_ + names.size());
+   std::memcpy(image.data() + header.records_offset_, records.data(), records.size() * sizeof(Record));
+   std::memcpy(image.data() + header.by_name_offset_, by_name.data(), by_name.size() * sizeof(uint32_t));
+   std::memcpy(image.data() + header.names_offset_, names.data(), names.size());
+   header.payload_checksum_ = checksum(image.data() + sizeof(Header), image.size() - sizeof(Header));
+   header.header_checksum_ = checksum(reinterpret_cast<const char*>(&header), offsetof(Header, header_checksum_));
+   std::memcpy(image.data(), &header, sizeof(Header));
+
+   std::string temp = path + ".tmp";
+   int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0) { fail("Cannot create", temp); }
+   // Never leaves a partial index behind: on any failure before the rename, the temporary file goes too
+   auto abandon = [&](const std::string& what) {
+      int error = errno;
+      if (fd >= 0) { ::close(fd); }
+      ::unlink(temp.c_str());
+      errno = error;
+      fail(what, temp);
+   };
+   for (size_t written = 0; written < image.size();) {
+      ssize_t n = ::write(fd, image.data() + written, image.size() - written);
+      if (n < 0 && errno == EINTR) { continue; }
+      if (n < 0) { abandon("Cannot write"); }
+      written += n;
+   }
+   if (::fsync(fd) != 0) { abandon("Cannot sync"); }
+   int closed = ::close(fd);
+   fd = -1;
+   if (closed != 0) { abandon("Cannot close"); }
+   if (::rename(temp.c_str(), path.c_str()) != 0) { abandon("Cannot rename"); }
+
+   // The rename itself only survives a crash once the directory holding it is on disk
+   size_t slash = path.rfind('/');
+   std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+   int dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+   if (dir_fd < 0) { fail("Cannot open", directory); }
+   int synced = ::fsync(dir_fd);
+   ::close(dir_fd);
+   if (synced != 0) { fail("Cannot sync", directory); }
+}
+
+/**
+ * @brief Maps an index file written by write()
+ *
+ * @param verify_payload Whether to checksum (and bounds check) every record before serving from them. The header is always checked;
+ *    skipping the rest makes opening O(1) but trusts that the body of the file is intact.
+ * @throws std::runtime_error If the file cannot be opened or mapped
+ * @throws InvalidFormatException If the file is not an index file of this version, or is corrupt
+ */
+MappedFileIndex::MappedFileIndex(const std::string& path, bool verify_payload)
+   : base_{nullptr}, length_{0}, header_{nullptr}, records_{nullptr}, by_name_{nullptr}, names_{nullptr} {
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0) { fail("Cannot open", path); }
+
+   struct stat info;
+   if (::fstat(fd, &info) != 0) {
+      ::close(fd);
+      fail("Cannot stat", path);
+   }
+   length_ = info.st_size;
+   if (length_ < sizeof(Header)) {
+      ::close(fd);
+      throw InvalidFormatException("Not an index file (too short): " + path);
+   }
+
+   void* mapped = ::mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+   ::close(fd);
+   if (mapped == MAP_FAILED) { fail("Cannot map", path); }
+   base_ = static_cast<const char*>(mapped);
+
+   try {
+      header_ = reinterpret_cast<const Header*>(base_);
+      check(verify_payload);
+   } catch (const InvalidFormatException& e) {
+      ::munmap(mapped, length_);
+      throw InvalidFormatException(e.what() + (": " + path));
+   }
+   records_ = reinterpret_cast<const Record*>(base_ + header_->records_offset_);
+   by_name_ = reinterpret_cast<const uint32_t*>(base_ + header_->by_name_offset_);
+   names_ = base_ + header_->names_offset_;
+}
+
+/**
+ * @brief Checks the header (and optionally the payload) of the mapped file, throwing InvalidFormatException at the first problem
+ */
+void MappedFileIndex::check(bool verify_payload) const {
+   const Header& h = *header_;
+   if (std::memcmp(h.magic_, MAGIC, sizeof(MAGIC)) != 0) {
+      throw InvalidFormatException("Not an index file");
+   }
+   if (h.version_ != VERSION || h.header_size_ != sizeof(Header)) {
+      throw InvalidFormatException("Unsupported index version " + std::to_string(h.version_));
+   }
+   if (checksum(base_, offsetof(Header, header_checksum_)) != h.header_checksum_) {
+      throw InvalidFormatException("Corrupt index header");
+   }
+
+   // Every section has to lie within the file (and be aligned for its type) before anything is read from it
+   bool fits = h.count_ <= length_ / sizeof(Record)
+      && h.records_offset_ == sizeof(Header)
+      && h.by_name_offset_ == h.records_offset_ + h.count_ * sizeof(Record)
+      && h.names_offset_ == h.by_name_offset_ + h.count_ * sizeof(uint32_t)
+      && h.names_offset_ <= length_ && h.names_length_ == length_ - h.names_offset_;
+   if (!fits) {
+      throw InvalidFormatException("Corrupt index layout");
+   }
+   if (!verify_payload) {
+      return;
+   }
+
+   if (checksum(base_ + sizeof(Header), length_ - sizeof(Header)) != h.payload_checksum_) {
+      throw InvalidFormatException("Corrupt index payload");
+   }
+   const Record* records = reinterpret_cast<const Record*>(base_ + h.records_offset_);
+   const uint32_t* by_name = reinterpret_cast<const uint32_t*>(base_ + h.by_name_offset_);
+   for (size_t i = 0; i < h.count_; i++) {
+      const Record& r = records[i];
+      if (r.name_offset_ > h.names_length_ || r.name_length_ > h.names_length_ - r.name_offset_
+          || (i > 0 && r.size_ < records[i - 1].size_) || by_name[i] >= h.count_) {
+         throw InvalidFormatException("Corrupt index record " + std::to_string(i));
+      }
+   }
+}
+
+/**
+ * @brief Unmaps the index file
+ */
+MappedFileIndex::~MappedFileIndex() {
+   ::munmap(const_cast<char*>(base_), length_);
+}
+
+MappedFile MappedFileIndex::entry(const Record& r) const {
+   return MappedFile{std::string_view(names_ + r.name_offset_, r.name_length_), static_cast<size_t>(r.size_)};
+}
+
+std::string_view MappedFileIndex::nameOf(uint32_t index) const {
+   const Record& r = records_[index];
+   return std::string_view(names_ + r.name_offset_, r.name_length_);
+}
+
+/**
+ * @brief Retrieves all files whose sizes are within [min, max], in ascending order of size
+ * @note If the query interval is in descending order (ie. the given parameters min >= max),
+         the interval from [max, min] is searched (since max >= min)
+ */
+std::vector<MappedFile> MappedFileIndex::query(size_t min, size_t max) const {
+   if (min > max) { std::swap(min, max); }
+
+   const Record* end = records_ + header_->count_;
+   const Record* first = std::partition_point(records_, end, [&](const Record& r) { return r.size_ < min; });
+   const Record* last = std::partition_point(first, end, [&](const Record& r) { return r.size_ <= max; });
+
+   std::vector<MappedFile> result;
+   result.reserve(last - first);
+   for (const Record* r = first; r != last; ++r) { result.push_back(entry(*r)); }
+   return result;
+}
+
+/**
+ * @brief Retrieves all files whose name begins with some prefix, case insensitive, in case-insensitive order of name
+ *
+ * @return The matching files, or an empty vector if there are none (or the prefix is empty)
+ */
+std::vector<MappedFile> MappedFileIndex::getFilesWithPrefix(const std::string& prefix) const {
+   std::vector<MappedFile> result;
+   if (prefix.empty()) {
+      return result;
+   }
+
+   // Names starting with the prefix sit together in the by-name order: below them compare less, above them greater
+   auto below = [&](uint32_t i) { return foldedLess(nameOf(i).substr(0, prefix.size()), prefix); };
+   auto within = [&](uint32_t i) { return !foldedLess(prefix, nameOf(i).substr(0, prefix.size())); };
+
+   const uint32_t* end = by_name_ + header_->count_;
+   const uint32_t* first = std::partition_point(by_name_, end, below);
+   const uint32_t* last = std::partition_point(first, end, within);
+
+   result.reserve(last - first);
+   for (const uint32_t* i = first; i != last; ++i) { result.push_back(entry(records_[*i])); }
+   return result;
+}
+
+/**
+ * @brief Returns the number of files in the index
+ */
+size_t MappedFileIndex::size() const {
+   return header_->count_;
+}
+
+/**
+ * @brief Returns the sequence number the index was written with
+ */
+uint64_t MappedFileIndex::sequence() const {
+   return header_->sequence_;
+}
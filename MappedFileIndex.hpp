@@ -0,0 +1,116 @@
+/**
+ * @file MappedFileIndex.hpp
+ * @brief Defines the on-disk index format and MappedFileIndex, which answers queries straight from a memory-mapped index file
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "InvalidFormatException.hpp"
+
+class FileAVL;
+
+/**
+ * @brief A file as recorded in an index file: its name points into the mapped pages, so it is only valid
+ *    for as long as the MappedFileIndex it came from
+ */
+struct MappedFile {
+   std::string_view name_;
+   size_t size_;
+};
+
+/**
+ * @brief A read-only index of file names and sizes served directly from a memory-mapped index file.
+ *    Opening one maps the file and checks it, without building any nodes, so startup costs a few page faults
+ *    (plus one pass over the file if the payload checksum is verified) instead of one insert per file.
+ *
+ *    The format (native byte order, every offset relative to the start of the file, so it can be mapped anywhere):
+ *    - Header: magic, format version, header size, sequence number, record count, section offsets,
+ *      a checksum of everything after the header, then a checksum of the header itself
+ *    - Records: one {size, name offset, name length} per file, in ascending order of size
+ *    - By name: the index of every record, in case-insensitive order of name
+ *    - Names: the bytes of every name, back to back
+ */
+class MappedFileIndex {
+   public:
+   // The version written by write(); files of any other version are rejected
+   static const uint32_t VERSION = 1;
+
+   /**
+    * @brief Writes an index of every file in tree to path. The index is written beside path and renamed over it
+    *    once it is safely on disk (the directory too), so a crash never leaves a half-written index behind, and
+    *    once write() returns the new index is there to stay.
+    *
+    * @param sequence A number stored in the header for the caller to identify this index by (eg. the last change it includes)
+    * @throws std::runtime_error If the file cannot be written
+    */
+   static void write(const std::string& path, const FileAVL& tree, uint64_t sequence = 0);
+
+   /**
+    * @brief Writes an index of the given names and sizes to path, the same way as above
+    *
+    * @param files The files to index, in any order; the names only have to stay valid until write() returns
+    * @throws std::runtime_error If the file cannot be written
+    */
+   static void write(const std::string& path, std::vector<MappedFile> files, uint64_t sequence = 0);
+
+   /**
+    * @brief Maps an index file written by write()
+    *
+    * @param verify_payload Whether to checksum (and bounds check) every record before serving from them. The header is always checked;
+    *    skipping the rest makes opening O(1) but trusts that the body of the file is intact.
+    * @throws std::runtime_error If the file cannot be opened or mapped
+    * @throws InvalidFormatException If the file is not an index file of this version, or is corrupt
+    */
+   explicit MappedFileIndex(const std::string& path, bool verify_payload = true);
+
+   MappedFileIndex(const MappedFileIndex&) = delete;
+   MappedFileIndex& operator=(const MappedFileIndex&) = delete;
+
+   /**
+    * @brief Retrieves all files whose sizes are within [min, max], in ascending order of size
+    * @note If the query interval is in descending order (ie. the given parameters min >= max),
+            the interval from [max, min] is searched (since max >= min)
+    */
+   std::vector<MappedFile> query(size_t min, size_t max) const;
+
+   /**
+    * @brief Retrieves all files whose name begins with some prefix, case insensitive, in case-insensitive order of name
+    *
+    * @return The matching files, or an empty vector if there are none (or the prefix is empty)
+    */
+   std::vector<MappedFile> getFilesWithPrefix(const std::string& prefix) const;
+
+   /**
+    * @brief Returns the number of files in the index
+    */
+   size_t size() const;
+
+   /**
+    * @brief Returns the sequence number the index was written with
+    */
+   uint64_t sequence() const;
+
+   /**
+    * @brief Unmaps the index file
+    */
+   ~MappedFileIndex();
+
+   private:
+      struct Header;
+      struct Record;
+
+      const char* base_;     // The start of the mapping
+      size_t length_;        // The length of the mapping
+      const Header* header_;
+      const Record* records_;
+      const uint32_t* by_name_;
+      const char* names_;
+
+      MappedFile entry(const Record& r) const;
+      std::string_view nameOf(uint32_t index) const;
+      void check(bool verify_payload) const;
+};
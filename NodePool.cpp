@@ -0,0 +1,139 @@
+#include "NodePool.hpp"
+#include "FileAVL.hpp"
+
+#include <algorithm>
+#include <new>
+
+// =========== FILE BUCKET  ===========
+
+/**
+ * @brief Appends a file, spilling into (or growing) pool storage if the bucket is full
+ */
+void FileBucket::push_back(File* f, NodePool& pool) {
+   if (size_ == capacity_) { reserve(size_t{capacity_} * 2, pool); }
+   data()[size_++] = f;
+}
+
+/**
+ * @brief Ensures the bucket can hold at least capacity files without growing
+ */
+void FileBucket::reserve(size_t capacity, NodePool& pool) {
+   if (capacity <= capacity_) { return; }
+
+   // Round up to a power of two so freed arrays can be recycled by size class
+   size_t rounded = 2;
+   while (rounded < capacity) { rounded *= 2; }
+
+   File** grown = pool.allocateFiles(rounded);
+   std::copy(begin(), end(), grown);
+   if (capacity_ > 1) { pool.freeFiles(many_, capacity_); }
+   many_ = grown;
+   capacity_ = static_cast<uint32_t>(rounded);
+}
+
+/**
+ * @brief Returns any spilled storage to the pool, leaving the bucket empty
+ */
+void FileBucket::release(NodePool& pool) {
+   if (capacity_ > 1) { pool.freeFiles(many_, capacity_); }
+   one_ = nullptr;
+   size_ = 0;
+   capacity_ = 1;
+}
+
+// =========== NODE POOL  ===========
+
+NodePool::NodePool() : chunks_{}, nodes_{nullptr, nullptr}, files_{nullptr, nullptr}, reserved_{0}, free_nodes_{nullptr}, free_files_{} {}
+
+NodePool::~NodePool() {
+   release();
+}
+
+/**
+ * @brief Constructs a new Node holding f
+ */
+Node* NodePool::create(File* f) {
+   void* slot;
+   if (free_nodes_) {
+      slot = free_nodes_;
+      free_nodes_ = free_nodes_->next_;
+   } else {
+      slot = carve(nodes_, sizeof(Node));
+   }
+   return new (slot) Node(f);
+}
+
+/**
+ * @brief Returns a Node (and its spilled bucket, if any) to the pool
+ */
+void NodePool::destroy(Node* n) {
+   n->files_.release(*this);
+   n->~Node();
+   free_nodes_ = new (n) FreeSlot{free_nodes_};
+}
+
+/**
+ * @brief Allocates an array for a spilled FileBucket
+ * @param capacity The number of File* to hold, a power of two >= 2
+ */
+File** NodePool::allocateFiles(size_t capacity) {
+   int size_class = 0;
+   while ((size_t{1} << size_class) < capacity) { size_class++; }
+
+   if (FreeSlot* recycled = free_files_[size_class]) {
+      free_files_[size_class] = recycled->next_;
+      return reinterpret_cast<File**>(recycled);
+   }
+   return static_cast<File**>(carve(files_, capacity * sizeof(File*)));
+}
+
+/**
+ * @brief Returns an array obtained from allocateFiles(capacity) to the pool
+ */
+void NodePool::freeFiles(File** files, size_t capacity) {
+   int size_class = 0;
+   while ((size_t{1} << size_class) < capacity) { size_class++; }
+   free_files_[size_class] = new (files) FreeSlot{free_files_[size_class]};
+}
+
+/**
+ * @brief Frees every chunk at once, invalidating all Nodes and arrays handed out so far. O(chunks), not O(Nodes).
+ */
+void NodePool::release() {
+   for (void* chunk : chunks_) {
+      ::operator delete(chunk, std::align_val_t(ALIGNMENT));
+   }
+   chunks_.clear();
+   nodes_ = files_ = Region{nullptr, nullptr};
+   reserved_ = 0;
+   free_nodes_ = nullptr;
+   std::fill(std::begin(free_files_), std::end(free_files_), nullptr);
+}
+
+/**
+ * @brief Carves bytes out of region, starting a new chunk if it is exhausted.
+ *    Requests larger than a quarter of a chunk get a dedicated chunk.
+ * @pre bytes is a multiple of the alignment callers need from consecutive carves
+ */
+void* NodePool::carve(Region& region, size_t bytes) {
+   if (bytes > CHUNK_BYTES / 4) { return newChunk(bytes); }
+
+   if (static_cast<size_t>(region.limit_ - region.cursor_) < bytes) {
+      region.cursor_ = newChunk(CHUNK_BYTES);
+      region.limit_ = region.cursor_ + CHUNK_BYTES;
+   }
+   void* slot = region.cursor_;
+   region.cursor_ += bytes;
+   return slot;
+}
+
+/**
+ * @brief Reserves a new cache-line-aligned chunk from the system
+ */
+char* NodePool::newChunk(size_t bytes) {
+   chunks_.reserve(chunks_.size() + 1);
+   char* chunk = static_cast<char*>(::operator new(bytes, std::align_val_t(ALIGNMENT)));
+   chunks_.push_back(chunk);
+   reserved_ += bytes;
+   return chunk;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file NodePool.hpp
+ * @brief Defines the slab allocator backing FileAVL's Nodes, and the FileBucket small-vector stored in each Node
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class File;
+struct Node;
+class NodePool;
+
+/**
+ * @brief The files of a single Node. A bucket holding one file stores it inline;
+ *    larger buckets spill into an array carved out of the tree's NodePool.
+ * @note Trivially destructible: spilled storage belongs to the pool, not to the bucket.
+ */
+class FileBucket {
+   public:
+      // Constructs a bucket holding exactly one file, stored inline
+      explicit FileBucket(File* f) : one_{f}, size_{1}, capacity_{1} {}
+
+      size_t size() const { return size_; }
+      bool empty() const { return size_ == 0; }
+
+      File** begin() { return data(); }
+      File** end() { return data() + size_; }
+      File* const* begin() const { return data(); }
+      File* const* end() const { return data() + size_; }
+
+      File*& operator[](size_t i) { return data()[i]; }
+      File* const& operator[](size_t i) const { return data()[i]; }
+      File*& front() { return data()[0]; }
+      File*& back() { return data()[size_ - 1]; }
+
+      /**
+       * @brief Appends a file, spilling into (or growing) pool storage if the bucket is full
+       */
+      void push_back(File* f, NodePool& pool);
+
+      /**
+       * @brief Removes the last file. Capacity is kept for later push_backs.
+       */
+      void pop_back() { size_--; }
+
+      /**
+       * @brief Ensures the bucket can hold at least capacity files without growing
+       */
+      void reserve(size_t capacity, NodePool& pool);
+
+      /**
+       * @brief Returns any spilled storage to the pool, leaving the bucket empty
+       */
+      void release(NodePool& pool);
+
+   private:
+      union {
+         File* one_;   // The only file, while capacity_ == 1
+         File** many_; // The spilled storage, once capacity_ > 1
+      };
+      uint32_t size_;
+      uint32_t capacity_;
+
+      File** data() { return capacity_ == 1 ? &one_ : many_; }
+      File* const* data() const { return capacity_ == 1 ? &one_ : many_; }
+};
+
+/**
+ * @brief A slab allocator for the Nodes (and spilled FileBuckets) of one FileAVL.
+ *    Memory is carved out of large cache-line-aligned chunks so that neighbouring Nodes share pages,
+ *    freed Nodes and bucket arrays are recycled through free lists, and the whole pool is released at once.
+ */
+class NodePool {
+   public:
+      NodePool();
+      ~NodePool();
+
+      NodePool(const NodePool&) = delete;
+      NodePool& operator=(const NodePool&) = delete;
+
+      /**
+       * @brief Constructs a new Node holding f
+       */
+      Node* create(File* f);
+
+      /**
+       * @brief Returns a Node (and its spilled bucket, if any) to the pool
+       */
+      void destroy(Node* n);
+
+      /**
+       * @brief Allocates an array for a spilled FileBucket
+       * @param capacity The number of File* to hold, a power of two >= 2
+       */
+      File** allocateFiles(size_t capacity);
+
+      /**
+       * @brief Returns an array obtained from allocateFiles(capacity) to the pool
+       */
+      void freeFiles(File** files, size_t capacity);
+
+      /**
+       * @brief Frees every chunk at once, invalidating all Nodes and arrays handed out so far. O(chunks), not O(Nodes).
+       */
+      void release();
+
+      /**
+       * @brief Returns the number of bytes currently reserved from the system
+       */
+      size_t bytesReserved() const { return reserved_; }
+
+   private:
+      static const size_t CHUNK_BYTES = 64 * 1024;
+      static const size_t ALIGNMENT = 64;  // One cache line
+      static const int SIZE_CLASSES = 32;  // Free lists for arrays of 2^1 ... 2^31 files
+
+      // A freed Node or array, threaded onto a free list through its first word
+      struct FreeSlot { FreeSlot* next_; };
+
+      // The unused tail of the chunk currently being carved up
+      struct Region {
+         char* cursor_;
+         char* limit_;
+      };
+
+      std::vector<void*> chunks_;
+      Region nodes_;  // Nodes are carved from their own chunks, so they stay densely packed
+      Region files_;  // Spilled bucket arrays are carved from separate chunks
+      size_t reserved_;
+      FreeSlot* free_nodes_;
+      FreeSlot* free_files_[SIZE_CLASSES];
+
+      /**
+       * @brief Carves bytes out of region, starting a new chunk if it is exhausted.
+       *    Requests larger than a quarter of a chunk get a dedicated chunk.
+       * @pre bytes is a multiple of the alignment callers need from consecutive carves
+       */
+      void* carve(Region& region, size_t bytes);
+
+      /**
+       * @brief Reserves a new cache-line-aligned chunk from the system
+       */
+      char* newChunk(size_t bytes);
+};
@@ -0,0 +1,185 @@
+#include "PersistentFileAVL.hpp"
+
+#include <algorithm>
+
+PersistentFileAVL::SharedNode::SharedNode(size_t size, Bucket files, NodePtr left, NodePtr right)
+   : size_{size}, files_{std::move(files)}, height_{1 + std::max(avlHeight(left), avlHeight(right))},
+     count_{files_->size() + (left ? left->count_ : 0) + (right ? right->count_ : 0)},
+     left_{std::move(left)}, right_{std::move(right)} {}
+
+/**
+ * @brief Default Constructor: Construct a new, empty PersistentFileAVL
+ */
+PersistentFileAVL::PersistentFileAVL() : root_{nullptr} {}
+
+/**
+ * @brief Wraps an existing version of the tree
+ */
+PersistentFileAVL::PersistentFileAVL(NodePtr root) : root_{std::move(root)} {}
+
+/**
+ * @brief Builds a copy of like (sharing its bucket) above left and right
+ */
+PersistentFileAVL::NodePtr PersistentFileAVL::join(const NodePtr& like, const NodePtr& left, const NodePtr& right) {
+   return std::make_shared<const SharedNode>(like->size_, like->files_, left, right);
+}
+
+/**
+ * @brief Builds a copy of top above left and right, rotating if the two subtrees are out of balance
+ */
+PersistentFileAVL::NodePtr PersistentFileAVL::balance(const NodePtr& top, const NodePtr& left, const NodePtr& right) {
+   // Rotating rebuilds the Nodes it moves rather than changing them, since other versions may share them
+   return avlBalance(ALLOWED_IMBALANCE, top, left, right, join);
+}
+
+/**
+ * @brief Returns a copy of subroot with target inserted, sharing every untouched subtree
+ *
+ * @param added Set to false if target was already there (in which case subroot itself is returned)
+ */
+PersistentFileAVL::NodePtr PersistentFileAVL::insert(const NodePtr& subroot, File* target, size_t size, bool& added) {
+   if (!subroot) {
+      added = true;
+      return std::make_shared<const SharedNode>(size, std::make_shared<const std::vector<File*>>(1, target), nullptr, nullptr);
+   }
+
+   if (size < subroot->size_) {
+      NodePtr left = insert(subroot->left_, target, size, added);
+      return added ? balance(subroot, left, subroot->right_) : subroot;
+   }
+   if (size > subroot->size_) {
+      NodePtr right = insert(subroot->right_, target, size, added);
+      return added ? balance(subroot, subroot->left_, right) : subroot;
+   }
+
+   // Only this Node's bucket changes, so it is the only one copied
+   const std::vector<File*>& files = *subroot->files_;
+   added = std::find(files.begin(), files.end(), target) == files.end();
+   if (!added) {
+      return subroot;
+   }
+   auto grown = std::make_shared<std::vector<File*>>();
+   grown->reserve(files.size() + 1);
+   grown->assign(files.begin(), files.end());
+   grown->push_back(target);
+   return std::make_shared<const SharedNode>(subroot->size_, std::move(grown), subroot->left_, subroot->right_);
+}
+
+/**
+ * @brief Returns a copy of subroot without its smallest Node, which is handed back through min
+ */
+PersistentFileAVL::NodePtr PersistentFileAVL::removeMin(const NodePtr& subroot, NodePtr& min) {
+   if (!subroot->left_) {
+      min = subroot;
+      return subroot->right_;
+   }
+   NodePtr left = removeMin(subroot->left_, min);
+   return balance(subroot, left, subroot->right_);
+}
+
+/**
+ * @brief Returns a copy of subroot with target removed, sharing every untouched subtree
+ *
+ * @param removed Set to false if target was not there (in which case subroot itself is returned)
+ */
+PersistentFileAVL::NodePtr PersistentFileAVL::remove(const NodePtr& subroot, File* target, size_t size, bool& removed) {
+   if (!subroot) {
+      removed = false;
+      return subroot;
+   }
+
+   if (size < subroot->size_) {
+      NodePtr left = remove(subroot->left_, target, size, removed);
+      return removed ? balance(subroot, left, subroot->right_) : subroot;
+   }
+   if (size > subroot->size_) {
+      NodePtr right = remove(subroot->right_, target, size, removed);
+      return removed ? balance(subroot, subroot->left_, right) : subroot;
+   }
+
+   const std::vector<File*>& files = *subroot->files_;
+   auto found = std::find(files.begin(), files.end(), target);
+   removed = found != files.end();
+   if (!removed) {
+      return subroot;
+   }
+   if (files.size() > 1) {
+      auto shrunk = std::make_shared<std::vector<File*>>(files.begin(), found);
+      shrunk->insert(shrunk->end(), found + 1, files.end());
+      return std::make_shared<const SharedNode>(subroot->size_, std::move(shrunk), subroot->left_, subroot->right_);
+   }
+
+   // The Node is now empty: splice it out, replacing it with its successor if it has two children
+   if (!subroot->left_) {
+      return subroot->right_;
+   }
+   if (!subroot->right_) {
+      return subroot->left_;
+   }
+   NodePtr successor;
+   NodePtr right = removeMin(subroot->right_, successor);
+   return balance(successor, subroot->left_, right);
+}
+
+/**
+ * @brief Returns a version with target inserted, leaving this one untouched. Runs in O(log N).
+ *
+ * @param target The file to be inserted
+ * @return The new version, or a copy of this one if target was already in it
+ */
+PersistentFileAVL PersistentFileAVL::insert(File* target) const {
+   bool added = false;
+   return PersistentFileAVL(insert(root_, target, target->getSize(), added));
+}
+
+/**
+ * @brief Returns a version with target removed, leaving this one untouched. Runs in O(log N).
+ *
+ * @param target The file to be removed, which must still have the size it was inserted with
+ * @return The new version, or a copy of this one if target was not in it
+ */
+PersistentFileAVL PersistentFileAVL::remove(File* target) const {
+   bool removed = false;
+   return PersistentFileAVL(remove(root_, target, target->getSize(), removed));
+}
+
+/**
+ * @brief Adds the files of subroot whose sizes are within [min, max] to result, in ascending order of size,
+ *    only visiting the subtrees that can hold a size in range
+ */
+void PersistentFileAVL::search(const SharedNode* subroot, size_t min, size_t max, std::vector<File*>& result) {
+   if (!subroot) {
+      return;
+   }
+   if (subroot->size_ > min) {
+      search(subroot->left_.get(), min, max, result);
+   }
+   if (subroot->size_ >= min && subroot->size_ <= max) {
+      result.insert(result.end(), subroot->files_->begin(), subroot->files_->end());
+   }
+   if (subroot->size_ < max) {
+      search(subroot->right_.get(), min, max, result);
+   }
+}
+
+/**
+ * @brief Retrieves all files in this version whose file sizes are within [min, max]
+ *
+ * @return std::vector<File*> storing pointers to all files within the given range, in ascending order of size.
+ * @note If the query interval is in descending order (ie. the given parameters min >= max),
+         the interval from [max, min] is searched (since max >= min)
+ */
+std::vector<File*> PersistentFileAVL::query(size_t min, size_t max) const {
+   if (min > max) { std::swap(min, max); }
+
+   std::vector<File*> result;
+   search(root_.get(), min, max, result);
+   return result;
+}
+
+/**
+ * @brief Returns the number of files in this version
+ */
+size_t PersistentFileAVL::size() const {
+   return root_ ? root_->count_ : 0;
+}
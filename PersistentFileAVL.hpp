@@ -0,0 +1,121 @@
+/**
+ * @file PersistentFileAVL.hpp
+ * @brief Defines the interface for PersistentFileAVL, an immutable FileAVL whose versions share structure
+ */
+
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "AVLBalance.hpp"
+#include "File.hpp"
+
+class ConcurrentFileAVL;
+
+/**
+ * @brief A size-keyed AVL tree of files with the same contract as FileAVL, except that it never changes:
+ *    insert() and remove() return a new version, copying only the path from the root down to the change
+ *    (rotations included) and sharing every other Node with the version they started from. Buckets are shared
+ *    too, so only the Node whose files changed copies its bucket.
+ *    Copying a PersistentFileAVL is O(1), so any version can be kept as a snapshot for as long as needed;
+ *    a Node is reclaimed when the last version using it is destroyed. Versions may be read from any thread.
+ */
+class PersistentFileAVL {
+   public:
+   /**
+    * @brief Default Constructor: Construct a new, empty PersistentFileAVL
+    */
+   PersistentFileAVL();
+
+   /**
+    * @brief Retrieves all files in this version whose file sizes are within [min, max]
+    *
+    * @return std::vector<File*> storing pointers to all files within the given range, in ascending order of size.
+    * @note If the query interval is in descending order (ie. the given parameters min >= max),
+            the interval from [max, min] is searched (since max >= min)
+    */
+   std::vector<File*> query(size_t min, size_t max) const;
+
+   /**
+    * @brief Returns a version with target inserted, leaving this one untouched. Runs in O(log N).
+    *
+    * @param target The file to be inserted
+    * @return The new version, or a copy of this one if target was already in it
+    */
+   [[nodiscard]] PersistentFileAVL insert(File* target) const;
+
+   /**
+    * @brief Returns a version with target removed, leaving this one untouched. Runs in O(log N).
+    *
+    * @param target The file to be removed, which must still have the size it was inserted with
+    * @return The new version, or a copy of this one if target was not in it
+    */
+   [[nodiscard]] PersistentFileAVL remove(File* target) const;
+
+   /**
+    * @brief Returns the number of files in this version
+    */
+   size_t size() const;
+
+   /**
+    * @brief Returns true if both versions share the same root, i.e. they are the same version
+    */
+   bool operator==(const PersistentFileAVL& rhs) const { return root_ == rhs.root_; }
+   bool operator!=(const PersistentFileAVL& rhs) const { return root_ != rhs.root_; }
+
+   private:
+      // Publishes versions atomically through their roots
+      friend class ConcurrentFileAVL;
+
+      struct SharedNode;
+      using NodePtr = std::shared_ptr<const SharedNode>;
+      using Bucket = std::shared_ptr<const std::vector<File*>>;
+
+      // A SharedNode is never modified after it has been built, so any number of trees (and threads) can share it
+      struct SharedNode {
+         size_t size_;               // The size shared by every file of this Node
+         Bucket files_;              // The files of this size, shared by every copy of this Node
+         int height_;                // The height of the Node
+         size_t count_;              // The number of files stored in the subtree rooted at this Node
+         NodePtr left_;
+         NodePtr right_;
+
+         SharedNode(size_t size, Bucket files, NodePtr left, NodePtr right);
+      };
+
+      static const int ALLOWED_IMBALANCE = 1;
+      NodePtr root_;
+
+      explicit PersistentFileAVL(NodePtr root);
+
+      /**
+       * @brief Builds a copy of like (sharing its bucket) above left and right
+       */
+      static NodePtr join(const NodePtr& like, const NodePtr& left, const NodePtr& right);
+
+      /**
+       * @brief Builds a copy of top above left and right, rotating if the two subtrees are out of balance
+       */
+      static NodePtr balance(const NodePtr& top, const NodePtr& left, const NodePtr& right);
+
+      /**
+       * @brief Returns a copy of subroot with target inserted, sharing every untouched subtree
+       *
+       * @param added Set to false if target was already there (in which case subroot itself is returned)
+       */
+      static NodePtr insert(const NodePtr& subroot, File* target, size_t size, bool& added);
+
+      /**
+       * @brief Returns a copy of subroot with target removed, sharing every untouched subtree
+       *
+       * @param removed Set to false if target was not there (in which case subroot itself is returned)
+       */
+      static NodePtr remove(const NodePtr& subroot, File* target, size_t size, bool& removed);
+
+      /**
+       * @brief Returns a copy of subroot without its smallest Node, which is handed back through min
+       */
+      static NodePtr removeMin(const NodePtr& subroot, NodePtr& min);
+
+      static void search(const SharedNode* subroot, size_t min, size_t max, std::vector<File*>& result);
+};
@@ -0,0 +1,156 @@
+#include "RadixFileTrie.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+/**
+ * @brief Default Constructor: Construct a new RadixFileTrie object
+ */
+RadixFileTrie::RadixFileTrie() : head{nullptr} {}
+
+/**
+ * @brief Destroy the RadixFileTrie, deallocating all necessary RadixTrieNodes
+ */
+RadixFileTrie::~RadixFileTrie() {
+    deleteTrie(head);
+    head = nullptr;
+}
+
+/**
+ * @brief Destroys the given RadixTrieNode and its children
+ *
+ * @param sub_head The node to be deleted
+ */
+void RadixFileTrie::deleteTrie(RadixTrieNode* sub_head) {
+    if (!sub_head) {
+        return;
+    }
+    for (RadixTrieNode* child : sub_head->children) {
+        deleteTrie(child);
+    }
+    delete sub_head;
+}
+
+/**
+ * @brief Finds the child of node whose label starts with c, by binary search over the sorted first characters
+ *
+ * @return The child, or nullptr if there is none
+ */
+RadixTrieNode* RadixFileTrie::findChild(RadixTrieNode* node, char c) const {
+    auto key = std::lower_bound(node->keys.begin(), node->keys.end(), c);
+    if (key == node->keys.end() || *key != c) {
+        return nullptr;
+    }
+    return node->children[key - node->keys.begin()];
+}
+
+/**
+ * @brief Adds file into RadixFileTrie object, case insensitive
+ *
+ * @param f The file to be added
+ */
+void RadixFileTrie::addFile(File* f) {
+    if (!head) {
+        head = new RadixTrieNode();
+    }
+
+    std::string name = f->getName();
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    RadixTrieNode* node = head;
+    size_t pos = 0;
+
+    while (pos < name.size()) {
+        RadixTrieNode* child = findChild(node, name[pos]);
+
+        //no edge starts with this char: hang the rest of the name off a single new node
+        if (!child) {
+            RadixTrieNode* leaf = new RadixTrieNode(name.substr(pos));
+            leaf->files.push_back(f);
+
+            auto key = std::lower_bound(node->keys.begin(), node->keys.end(), name[pos]);
+            node->children.insert(node->children.begin() + (key - node->keys.begin()), leaf);
+            node->keys.insert(key, name[pos]);
+            return;
+        }
+
+        //length of the common prefix of the edge label and the rest of the name
+        const std::string& label = child->label;
+        size_t common = 0;
+        while (common < label.size() && pos + common < name.size() && label[common] == name[pos + common]) {
+            ++common;
+        }
+
+        //the name diverges partway along the edge: split the edge at the point of divergence
+        if (common < label.size()) {
+            RadixTrieNode* middle = new RadixTrieNode(label.substr(0, common));
+            child->label.erase(0, common);
+            middle->keys.push_back(child->label[0]);
+            middle->children.push_back(child);
+
+            auto key = std::lower_bound(node->keys.begin(), node->keys.end(), middle->label[0]);
+            node->children[key - node->keys.begin()] = middle;
+            child = middle;
+        }
+
+        node = child;
+        pos += common;
+    }
+
+    node->files.push_back(f);
+}
+
+/**
+ * @brief Adds every file stored in the given subtree into result
+ */
+void RadixFileTrie::collect(const RadixTrieNode* subroot, std::unordered_set<File*>& result) const {
+    result.insert(subroot->files.begin(), subroot->files.end());
+    for (const RadixTrieNode* child : subroot->children) {
+        collect(child, result);
+    }
+}
+
+/**
+ * @brief Searches the RadixFileTrie for some prefix and returns a set of Files that begin with that prefix.
+ *      If no match is found (or the prefix is empty), then an empty set is returned.
+ *
+ * @param prefix Prefix that is being searched for, case insensitive
+ * @return Set of all Files with the same prefix, if found, else empty set.
+ */
+std::unordered_set<File*> RadixFileTrie::getFilesWithPrefix(const std::string& prefix) const {
+    std::unordered_set<File*> result;
+    if (prefix.empty() || !head) {
+        return result;
+    }
+
+    RadixTrieNode* node = head;
+    size_t pos = 0;
+
+    while (pos < prefix.size()) {
+        node = findChild(node, std::tolower(static_cast<unsigned char>(prefix[pos])));
+        if (!node) {
+            return result;
+        }
+
+        //walk along the edge as far as the prefix goes
+        const std::string& label = node->label;
+        size_t common = 0;
+        while (common < label.size() && pos + common < prefix.size()
+               && label[common] == std::tolower(static_cast<unsigned char>(prefix[pos + common]))) {
+            ++common;
+        }
+
+        //the prefix ran out somewhere along (or at the end of) this edge: everything below matches
+        if (pos + common == prefix.size()) {
+            break;
+        }
+        //the prefix disagrees with the edge: nothing matches
+        if (common < label.size()) {
+            return result;
+        }
+        pos += common;
+    }
+
+    collect(node, result);
+    return result;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file RadixFileTrie.hpp
+ * @brief Defines the interface for the RadixFileTrie class & implementation of the RadixTrieNode struct
+ */
+
+#pragma once
+#include <unordered_set>
+#include <string>
+#include <vector>
+#include "File.hpp"
+
+/**
+ * @brief A node of a path-compressed trie. Each node is reached through an edge labelled with one or more
+ *      (lower case) characters, and chains of single-child nodes are merged into a single edge.
+ */
+struct RadixTrieNode {
+    std::string label;                     // The characters on the edge leading into this node
+    std::vector<File*> files;              // Files whose (lower case) name ends exactly at this node
+    std::vector<char> keys;                // The first character of each child's label, sorted
+    std::vector<RadixTrieNode*> children;  // The children, parallel to keys
+
+    RadixTrieNode(const std::string& l = "") : label{l}, files{}, keys{}, children{} {}
+};
+
+/**
+ * @brief A path-compressed (radix) variant of FileTrie with the same contract: case-insensitive prefix search
+ *      over file names. Long, unbranched runs of characters share a single node, and each node finds its
+ *      children by searching a small sorted array of first characters instead of hashing.
+ */
+class RadixFileTrie {
+    private:
+        RadixTrieNode* head;
+        void deleteTrie(RadixTrieNode* sub_head);
+        RadixTrieNode* findChild(RadixTrieNode* node, char c) const;
+        void collect(const RadixTrieNode* subroot, std::unordered_set<File*>& result) const;
+    public:
+        /**
+         * @brief Default Constructor: Construct a new RadixFileTrie object
+         */
+        RadixFileTrie();
+
+        RadixFileTrie(const RadixFileTrie&) = delete;
+        RadixFileTrie& operator=(const RadixFileTrie&) = delete;
+
+        /**
+         * @brief Adds file into RadixFileTrie object, case insensitive
+         *
+         * @param f The file to be added
+         */
+        void addFile(File* f);
+
+        /**
+         * @brief Searches the RadixFileTrie for some prefix and returns a set of Files that begin with that prefix.
+         *      If no match is found (or the prefix is empty), then an empty set is returned.
+         *
+         * @param prefix Prefix that is being searched for, case insensitive
+         * @return Set of all Files with the same prefix, if found, else empty set.
+         */
+        std::unordered_set<File*> getFilesWithPrefix(const std::string& prefix) const;
+
+        /**
+         * @brief Destroy the RadixFileTrie, deallocating all necessary RadixTrieNodes
+         */
+        ~RadixFileTrie();
+};
@@ -0,0 +1,1541 @@
+/**
+ * @file bench.cpp
+ * @brief Benchmark driver for the file indexes. Run as `./bench [section] [n]`, or with no arguments to run every section.
+ */
+
+#include "ConcurrentFileAVL.hpp"
+#include "ConcurrentFileTrie.hpp"
+#include "DirectoryCrawler.hpp"
+#include "DirectoryScanner.hpp"
+#include "File.hpp"
+#include "FileAVL.hpp"
+#include "FileIndexLog.hpp"
+#include "FileNameIndex.hpp"
+#include "FileTrie.hpp"
+#include "FrozenFileAVL.hpp"
+#include "IconPool.hpp"
+#include "MappedFileIndex.hpp"
+#include "PersistentFileAVL.hpp"
+#include "RadixFileTrie.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// =========== ALLOCATION COUNTING  ===========
+
+namespace {
+std::atomic<size_t> g_allocations{0};     // The number of calls to operator new so far (relaxed: benchmarks may allocate from many threads)
+std::atomic<size_t> g_allocated_bytes{0}; // The number of bytes requested from operator new so far
+}
+
+void* operator new(size_t bytes) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (void* p = std::malloc(bytes ? bytes : 1)) { return p; }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t bytes, std::align_val_t align) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(align);
+    if (void* p = std::aligned_alloc(a, (bytes + a - 1) / a * a)) { return p; }
+    throw std::bad_alloc();
+}
+
+// GCC cannot tell that these free() calls pair with the malloc()s above; the warning stays on everywhere else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Runs fn `reps` times and returns the average time per run in microseconds
+ */
+double timeMicros(size_t reps, const std::function<void()>& fn) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < reps; i++) {
+        fn();
+    }
+    std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+    return elapsed.count() / reps;
+}
+
+/**
+ * @brief Builds n files named "f<i>.txt" whose sizes are uniformly drawn from [0, max_size)
+ */
+std::vector<File> makeFiles(size_t n, size_t max_size, unsigned seed = 335) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> dist(0, max_size - 1);
+
+    std::vector<File> files;
+    files.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        files.emplace_back("f" + std::to_string(i), std::string(dist(rng), 'x'));
+    }
+    return files;
+}
+
+/**
+ * @brief Builds n empty files with distinct, realistic names such as "QuarterlyReport2019v3.pdf" or "img04512.jpg"
+ */
+std::vector<File> makeNamedFiles(size_t n, unsigned seed = 335) {
+    static const std::vector<std::string> words = {
+        "report", "Quarterly", "budget", "invoice", "notes", "draft", "final", "Meeting", "summary", "photo",
+        "IMG", "scan", "backup", "config", "readme", "Project", "data", "export", "log", "thesis",
+        "chapter", "slides", "resume", "contract", "Proposal", "design", "sketch", "test", "build", "release"};
+    static const std::vector<std::string> extensions = {"txt", "pdf", "docx", "jpg", "png", "log", "csv", "cpp", "md", ""};
+
+    std::mt19937 rng(seed);
+    std::unordered_set<std::string> seen;
+    std::vector<File> files;
+    files.reserve(n);
+    while (files.size() < n) {
+        std::string name = words[rng() % words.size()];
+        if (rng() % 2) { name += words[rng() % words.size()]; }
+        name += std::to_string(rng() % (rng() % 2 ? 100000 : 2030));
+        if (rng() % 4 == 0) { name += "v" + std::to_string(rng() % 10); }
+        name += "." + extensions[rng() % extensions.size()];
+        if (seen.insert(name).second) { files.emplace_back(name); }
+    }
+    return files;
+}
+
+/**
+ * @brief The pre-pruning query: walk every node of the tree and keep the ones in range
+ */
+std::vector<File*> fullTraversal(FileAVL& tree, size_t min, size_t max) {
+    std::vector<File*> result;
+    for (File* f : tree.query(0, std::numeric_limits<size_t>::max())) {
+        if (f->getSize() >= min && f->getSize() <= max) { result.push_back(f); }
+    }
+    return result;
+}
+
+// =========== SECTIONS  ===========
+
+void benchRange(size_t n) {
+    const size_t max_size = 16384;
+    std::vector<File> files = makeFiles(n, max_size);
+    FileAVL tree;
+    for (File& f : files) { tree.insert(&f); }
+
+    std::cout << "[range] " << n << " files, sizes in [0, " << max_size << ")" << std::endl;
+    for (size_t width : {0, 16, 256, 4096}) {
+        size_t lo = max_size / 4, hi = lo + width;
+        size_t matches = tree.query(lo, hi).size();
+        if (fullTraversal(tree, lo, hi).size() != matches) {
+            std::cerr << "[range] mismatch for [" << lo << ", " << hi << "]" << std::endl;
+            std::exit(1);
+        }
+        double pruned = timeMicros(200, [&] { tree.query(lo, hi); });
+        double full = timeMicros(200, [&] { fullTraversal(tree, lo, hi); });
+        std::cout << "  [" << lo << ", " << hi << "] " << matches << " hits: pruned " << pruned
+                  << " us, full traversal " << full << " us" << std::endl;
+    }
+}
+
+void benchStats(size_t n) {
+    const size_t max_size = 16384;
+    std::vector<File> files = makeFiles(n, max_size);
+    FileAVL tree;
+    for (File& f : files) { tree.insert(&f); }
+
+    std::cout << "[stats] " << n << " files, sizes in [0, " << max_size << ")" << std::endl;
+    size_t lo = max_size / 4, hi = max_size / 2;
+    std::vector<File*> hits = tree.query(lo, hi);
+    size_t hit_bytes = 0;
+    for (File* f : hits) { hit_bytes += f->getSize(); }
+    File* median = tree.select(n / 2);
+    if (tree.countInRange(lo, hi) != hits.size() || tree.bytesInRange(lo, hi) != hit_bytes
+        || !median || tree.rank(median->getSize()) > n / 2) {
+        std::cerr << "[stats] aggregate mismatch" << std::endl;
+        std::exit(1);
+    }
+
+    double counted = timeMicros(10000, [&] { tree.countInRange(lo, hi); });
+    double summed = timeMicros(10000, [&] { tree.bytesInRange(lo, hi); });
+    double materialized = timeMicros(100, [&] { tree.query(lo, hi); });
+    double selected = timeMicros(10000, [&] { tree.select(n / 2); });
+    std::cout << "  [" << lo << ", " << hi << "] " << hits.size() << " hits: countInRange " << counted
+              << " us, bytesInRange " << summed << " us, query().size() " << materialized << " us" << std::endl;
+    std::cout << "  median size " << median->getSize() << ": select " << selected << " us" << std::endl;
+}
+
+void benchStream(size_t n) {
+    const size_t max_size = 16384;
+    std::vector<File> files = makeFiles(n, max_size);
+    FileAVL tree;
+    for (File& f : files) { tree.insert(&f); }
+
+    std::cout << "[stream] " << n << " files, sizes in [0, " << max_size << ")" << std::endl;
+    size_t lo = max_size / 4, hi = max_size / 2;
+    std::vector<File*> expected = tree.query(hi, lo);
+    std::vector<File*> iterated(tree.range(hi, lo).begin(), tree.range(hi, lo).end());
+    std::vector<File*> visited;
+    tree.forEachInRange(hi, lo, [&](File* f) { visited.push_back(f); return true; });
+    if (iterated != expected || visited != expected) {
+        std::cerr << "[stream] lazy traversal disagrees with query()" << std::endl;
+        std::exit(1);
+    }
+
+    size_t sink = 0;
+    double materialized = timeMicros(200, [&] {
+        for (File* f : tree.query(lo, hi)) { sink += f->getSize(); }
+    });
+    double iterator = timeMicros(200, [&] {
+        for (File* f : tree.range(lo, hi)) { sink += f->getSize(); }
+    });
+    double visitor = timeMicros(200, [&] {
+        tree.forEachInRange(lo, hi, [&](File* f) { sink += f->getSize(); return true; });
+    });
+    std::cout << "  full scan of " << expected.size() << " hits: query " << materialized << " us, range " << iterator
+              << " us, forEachInRange " << visitor << " us" << std::endl;
+
+    double first_query = timeMicros(2000, [&] { sink += tree.query(lo, hi).front()->getSize(); });
+    double first_range = timeMicros(2000, [&] { sink += (*tree.range(lo, hi).begin())->getSize(); });
+    double first_visit = timeMicros(2000, [&] {
+        tree.forEachInRange(lo, hi, [&](File* f) { sink += f->getSize(); return false; });
+    });
+    std::cout << "  first hit only: query " << first_query << " us, range " << first_range
+              << " us, forEachInRange " << first_visit << " us (" << sink % 2 << ")" << std::endl;
+}
+
+void benchUpdate(size_t n) {
+    const size_t max_size = 1024;
+    std::vector<File> files = makeFiles(n, max_size);
+    std::vector<File> same(n, File("same", std::string(max_size, 'x')));
+    FileAVL tree;
+    for (File& f : files) { tree.insert(&f); }
+    for (File& f : same) { tree.insert(&f); }
+
+    std::cout << "[update] " << n << " files in [0, " << max_size << ") plus " << n << " files of size " << max_size << std::endl;
+    auto start = Clock::now();
+    for (size_t i = 0; i < n; i += 2) { tree.remove(&same[i]); }
+    std::chrono::duration<double, std::micro> removing = Clock::now() - start;
+
+    start = Clock::now();
+    for (size_t i = 0; i < n; i += 2) {
+        size_t old_size = files[i].getSize();
+        files[i] = File(files[i].getName(), std::string(max_size - 1 - old_size, 'y'));
+        tree.updateSize(&files[i], old_size);
+    }
+    std::chrono::duration<double, std::micro> updating = Clock::now() - start;
+
+    std::vector<File*> all = tree.query(0, max_size);
+    bool sorted = std::is_sorted(all.begin(), all.end(), [](File* a, File* b) { return a->getSize() < b->getSize(); });
+    if (!sorted || static_cast<size_t>(tree.size()) != n + n / 2 || all.size() != n + n / 2
+        || tree.countInRange(max_size, max_size) != n / 2) {
+        std::cerr << "[update] tree is inconsistent after removals and updates" << std::endl;
+        std::exit(1);
+    }
+    std::cout << "  remove from a shared bucket: " << removing.count() / (n / 2) << " us/file, updateSize: "
+              << updating.count() / (n / 2) << " us/file (incl. rebuilding the File)" << std::endl;
+
+    // Differential check: random inserts (some repeated), removes and resizes against a reference multiset,
+    // over few sizes so that buckets are shared and emptied often
+    std::vector<File> pool = makeFiles(2000, 64, 4);
+    FileAVL checked;
+    std::map<File*, size_t> present;
+    std::mt19937 rng(4);
+    bool agrees = true;
+    for (size_t step = 0; step < 200000; step++) {
+        File* f = &pool[rng() % pool.size()];
+        bool was_present = present.count(f) > 0;
+        switch (rng() % 3) {
+            case 0:
+                checked.insert(f);
+                present[f] = f->getSize();
+                break;
+            case 1:
+                if (checked.remove(f) != was_present) { agrees = false; }
+                present.erase(f);
+                break;
+            default: {
+                size_t old_size = was_present ? present[f] : f->getSize();
+                f->setContents(std::string(rng() % 64, 'z'));
+                if (checked.updateSize(f, old_size) != was_present) { agrees = false; }
+                if (was_present) { present[f] = f->getSize(); }
+                break;
+            }
+        }
+        if (step % 1000 == 0 || step + 1 == 200000) {
+            std::multiset<std::pair<size_t, File*>> expected, got;
+            for (const auto& [file, size] : present) { expected.emplace(size, file); }
+            for (File* file : checked.query(0, 64)) { got.emplace(file->getSize(), file); }
+            agrees = agrees && got == expected && static_cast<size_t>(checked.size()) == present.size()
+                && checked.countInRange(0, 31) == static_cast<size_t>(std::count_if(present.begin(), present.end(),
+                    [](const std::pair<File* const, size_t>& p) { return p.second <= 31; }));
+        }
+    }
+    if (!agrees) {
+        std::cerr << "[update] randomized insert/remove/updateSize disagreed with the reference" << std::endl;
+        std::exit(1);
+    }
+    std::cout << "  stress tests passed" << std::endl;
+}
+
+void benchBulk(size_t n) {
+    const size_t max_size = 16384;
+    std::vector<File> files = makeFiles(n, max_size);
+    std::vector<File*> pointers;
+    for (File& f : files) { pointers.push_back(&f); }
+
+    std::cout << "[bulk] " << n << " files, sizes in [0, " << max_size << ")" << std::endl;
+    auto start = Clock::now();
+    FileAVL one_by_one;
+    for (File* f : pointers) { one_by_one.insert(f); }
+    std::chrono::duration<double, std::milli> inserting = Clock::now() - start;
+
+    start = Clock::now();
+    FileAVL bulk(pointers.begin(), pointers.end());
+    std::chrono::duration<double, std::milli> loading = Clock::now() - start;
+
+    // Half the files up front, then the other half merged in as one batch
+    std::vector<File*> first_half(pointers.begin(), pointers.begin() + n / 2);
+    std::vector<File*> second_half(pointers.begin() + n / 2, pointers.end());
+    FileAVL merged(first_half.begin(), first_half.end());
+    start = Clock::now();
+    merged.insertBatch(second_half);
+    std::chrono::duration<double, std::milli> merging = Clock::now() - start;
+
+    std::vector<File*> expected = one_by_one.query(0, max_size);
+    if (bulk.query(0, max_size) != expected || merged.query(0, max_size) != expected || bulk.size() != one_by_one.size()) {
+        std::cerr << "[bulk] bulk-loaded tree differs from one-by-one insertion" << std::endl;
+        std::exit(1);
+    }
+    std::cout << "  insert one by one " << inserting.count() << " ms, bulk load " << loading.count()
+              << " ms, merge second half " << merging.count() << " ms" << std::endl;
+}
+
+void benchLayout(size_t n) {
+    // Measured at (at least) a million files, the size the layout was designed for. Files backed by (nonexistent)
+    // paths on disk carry their sizes without holding any contents, so the files themselves stay small.
+    n = std::max<size_t>(n, 1000000);
+    const size_t max_size = 4 * n;
+    std::vector<File> files;
+    files.reserve(n);
+    std::mt19937 sizes(335);
+    for (size_t i = 0; i < n; i++) {
+        files.push_back(File::fromDisk("/layout/f" + std::to_string(i) + ".txt", sizes() % max_size));
+    }
+
+    std::cout << "[layout] " << n << " files, sizes in [0, " << max_size << ")" << std::endl;
+    size_t allocations = g_allocations, bytes = g_allocated_bytes;
+    auto start = Clock::now();
+    FileAVL* tree = new FileAVL();
+    for (File& f : files) { tree->insert(&f); }
+    std::chrono::duration<double, std::milli> building = Clock::now() - start;
+    allocations = g_allocations - allocations;
+    bytes = g_allocated_bytes - bytes;
+
+    std::mt19937 rng(7);
+    std::vector<size_t> starts(1000);
+    for (size_t& lo : starts) { lo = rng() % max_size; }
+    size_t sink = 0, next = 0;
+    double narrow = timeMicros(100000, [&] {
+        size_t lo = starts[next++ % starts.size()];
+        tree->forEachInRange(lo, lo + 64, [&](File* f) { sink++; return true; });
+    });
+    double scan = timeMicros(100, [&] {
+        tree->forEachInRange(0, max_size, [&](File* f) { sink++; return true; });
+    });
+
+    start = Clock::now();
+    delete tree;
+    std::chrono::duration<double, std::milli> destroying = Clock::now() - start;
+
+    std::cout << "  build " << building.count() << " ms: " << allocations << " allocations, " << bytes
+              << " bytes (" << bytes / n << " bytes/file incl. slot map)" << std::endl;
+    std::cout << "  64-wide range " << narrow << " us, full scan " << scan << " us, destroy "
+              << destroying.count() << " ms (" << sink % 2 << ")" << std::endl;
+}
+
+void benchFrozen(size_t n) {
+    const size_t max_size = 16384;
+    std::vector<File> files = makeFiles(n, max_size);
+    FileAVL tree;
+    for (File& f : files) { tree.insert(&f); }
+
+    auto start = Clock::now();
+    FrozenFileAVL frozen = tree.freeze();
+    std::chrono::duration<double, std::milli> freezing = Clock::now() - start;
+
+    std::cout << "[frozen] " << n << " files, sizes in [0, " << max_size << "), freeze " << freezing.count() << " ms" << std::endl;
+    for (size_t lo : {size_t{0}, max_size / 4, max_size - 1, max_size + 7}) {
+        for (size_t hi : {lo, lo + 16, max_size / 2, std::numeric_limits<size_t>::max()}) {
+            if (frozen.query(lo, hi) != tree.query(lo, hi) || frozen.query(hi, lo) != tree.query(hi, lo)) {
+                std::cerr << "[frozen] snapshot disagrees with the tree on [" << lo << ", " << hi << "]" << std::endl;
+                std::exit(1);
+            }
+        }
+    }
+
+    std::mt19937 rng(7);
+    std::vector<size_t> starts(1000);
+    for (size_t& lo : starts) { lo = rng() % max_size; }
+    for (size_t width : {0, 64, 4096}) {
+        size_t sink = 0, next = 0;
+        double live = timeMicros(100000 / (width + 1) + 100, [&] {
+            size_t lo = starts[next++ % starts.size()];
+            tree.forEachInRange(lo, lo + width, [&](File* f) { sink += reinterpret_cast<size_t>(f); return true; });
+        });
+        double snapshot = timeMicros(100000 / (width + 1) + 100, [&] {
+            size_t lo = starts[next++ % starts.size()];
+            for (File* f : frozen.range(lo, lo + width)) { sink += reinterpret_cast<size_t>(f); }
+        });
+        std::cout << "  width " << width << ": FileAVL " << live << " us, frozen " << snapshot << " us (" << sink % 2 << ")" << std::endl;
+    }
+}
+
+void benchInsert(size_t n) {
+    // Distinct ascending sizes force a rotation on most inserts; random sizes mostly append to existing Nodes
+    std::vector<File> ascending;
+    ascending.reserve(n);
+    for (size_t i = 0; i < n; i++) { ascending.emplace_back("f" + std::to_string(i), std::string(i % 32768, 'x')); }
+    std::vector<File> random = makeFiles(n, 16384);
+
+    std::cout << "[insert] " << n << " files" << std::endl;
+    for (auto* files : {&ascending, &random}) {
+        double best = std::numeric_limits<double>::max();
+        for (int round = 0; round < 5; round++) {
+            FileAVL tree;
+            auto start = Clock::now();
+            for (File& f : *files) { tree.insert(&f); }
+            std::chrono::duration<double> elapsed = Clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        std::cout << "  " << (files == &ascending ? "ascending" : "random") << " sizes: "
+                  << static_cast<size_t>(n / best) << " inserts/s" << std::endl;
+    }
+}
+
+void benchRadix(size_t n) {
+    std::vector<File> files = makeNamedFiles(n);
+    std::cout << "[radix] " << n << " realistic file names" << std::endl;
+
+    size_t bytes = g_allocated_bytes;
+    auto start = Clock::now();
+    FileTrie* trie = new FileTrie();
+    for (File& f : files) { trie->addFile(&f); }
+    std::chrono::duration<double, std::milli> trie_build = Clock::now() - start;
+    size_t trie_bytes = g_allocated_bytes - bytes;
+
+    bytes = g_allocated_bytes;
+    start = Clock::now();
+    RadixFileTrie* radix = new RadixFileTrie();
+    for (File& f : files) { radix->addFile(&f); }
+    std::chrono::duration<double, std::milli> radix_build = Clock::now() - start;
+    size_t radix_bytes = g_allocated_bytes - bytes;
+
+    std::cout << "  FileTrie: build " << trie_build.count() << " ms, " << trie_bytes / n << " bytes/file" << std::endl;
+    std::cout << "  RadixFileTrie: build " << radix_build.count() << " ms, " << radix_bytes / n << " bytes/file" << std::endl;
+
+    std::mt19937 rng(11);
+    for (size_t length : {1, 3, 6, 10}) {
+        std::vector<std::string> prefixes;
+        for (int i = 0; i < 200; i++) {
+            const std::string& name = files[rng() % files.size()].getName();
+            prefixes.push_back(name.substr(0, std::min(length, name.size() - 1)));
+        }
+        prefixes.push_back("zzz");
+
+        size_t matches = 0, next = 0;
+        for (const std::string& p : prefixes) {
+            std::unordered_set<File*> expected = trie->getFilesWithPrefix(p);
+            if (radix->getFilesWithPrefix(p) != expected) {
+                std::cerr << "[radix] results differ for prefix " << p << std::endl;
+                std::exit(1);
+            }
+            matches += expected.size();
+        }
+        size_t reps = std::max<size_t>(1, 2000000 / (matches + 1));
+        double trie_lookup = timeMicros(reps, [&] { trie->getFilesWithPrefix(prefixes[next++ % prefixes.size()]); });
+        double radix_lookup = timeMicros(reps, [&] { radix->getFilesWithPrefix(prefixes[next++ % prefixes.size()]); });
+        std::cout << "  prefix length " << length << " (" << matches / prefixes.size() << " avg hits): FileTrie "
+                  << trie_lookup << " us, RadixFileTrie " << radix_lookup << " us" << std::endl;
+    }
+
+    delete trie;
+    delete radix;
+}
+
+void benchPrefix(size_t n) {
+    std::vector<File> files = makeNamedFiles(n);
+    FileTrie trie;
+    for (File& f : files) { trie.addFile(&f); }
+    std::cout << "[prefix] " << n << " realistic file names" << std::endl;
+
+    for (std::string prefix : {"r", "rep", "report1", "zzz"}) {
+        std::unordered_set<File*> expected = trie.getFilesWithPrefix(prefix);
+        FileTrie::PrefixView view = trie.viewFilesWithPrefix(prefix);
+        std::unordered_set<File*> viewed(view.begin(), view.end());
+        if (viewed != expected || view.size() != expected.size() || trie.countWithPrefix(prefix) != expected.size()) {
+            std::cerr << "[prefix] view disagrees with getFilesWithPrefix for " << prefix << std::endl;
+            std::exit(1);
+        }
+
+        size_t sink = 0;
+        size_t reps = std::max<size_t>(10, 1000000 / (expected.size() + 1));
+        double copied = timeMicros(reps, [&] { sink += trie.getFilesWithPrefix(prefix).size(); });
+        double viewing = timeMicros(reps, [&] {
+            for (File* f : trie.viewFilesWithPrefix(prefix)) { sink += reinterpret_cast<size_t>(f); }
+        });
+        double first = timeMicros(reps, [&] {
+            FileTrie::PrefixView v = trie.viewFilesWithPrefix(prefix);
+            if (!v.empty()) { sink += reinterpret_cast<size_t>(*v.begin()); }
+        });
+        double counting = timeMicros(100000, [&] { sink += trie.countWithPrefix(prefix); });
+        std::cout << "  \"" << prefix << "\" (" << expected.size() << " hits): getFilesWithPrefix " << copied
+                  << " us, iterate view " << viewing << " us, first hit " << first << " us, countWithPrefix "
+                  << counting << " us (" << sink % 2 << ")" << std::endl;
+    }
+}
+
+void benchTopK(size_t n) {
+    // Named files of random sizes
+    std::vector<File> named = makeNamedFiles(n);
+    std::mt19937 rng(5);
+    std::vector<File> files;
+    files.reserve(n);
+    for (File& f : named) { files.emplace_back(f.getName(), std::string(rng() % 4096, 'x')); }
+    FileTrie trie;
+    for (File& f : files) { trie.addFile(&f); }
+    std::cout << "[topk] " << n << " realistic file names, sizes in [0, 4096)" << std::endl;
+
+    auto by_size = [](const File* f) { return static_cast<double>(f->getSize()); };
+    for (std::string prefix : {"r", "rep", "report1"}) {
+        // The old way: fetch every match and sort it
+        auto sortAll = [&] {
+            std::unordered_set<File*> all = trie.getFilesWithPrefix(prefix);
+            std::vector<File*> sorted(all.begin(), all.end());
+            std::sort(sorted.begin(), sorted.end(), [](File* a, File* b) { return a->getSize() > b->getSize(); });
+            sorted.resize(std::min<size_t>(10, sorted.size()));
+            return sorted;
+        };
+
+        std::vector<File*> expected = sortAll(), bounded = trie.topKWithPrefix(prefix, 10);
+        std::vector<File*> scored = trie.topKWithPrefix(prefix, 10, by_size);
+        for (size_t i = 0; i < expected.size(); i++) {
+            if (bounded.size() != expected.size() || scored.size() != expected.size()
+                || bounded[i]->getSize() != expected[i]->getSize() || scored[i]->getSize() != expected[i]->getSize()) {
+                std::cerr << "[topk] ranking differs from a full sort for " << prefix << std::endl;
+                std::exit(1);
+            }
+        }
+
+        size_t reps = std::max<size_t>(10, 200000 / (trie.countWithPrefix(prefix) + 1));
+        double sorting = timeMicros(reps, [&] { sortAll(); });
+        double best_first = timeMicros(reps, [&] { trie.topKWithPrefix(prefix, 10); });
+        double callback = timeMicros(reps, [&] { trie.topKWithPrefix(prefix, 10, by_size); });
+        std::cout << "  \"" << prefix << "\" (" << trie.countWithPrefix(prefix) << " hits), top 10 by size: fetch + sort "
+                  << sorting << " us, best-first " << best_first << " us, caller score " << callback << " us" << std::endl;
+    }
+}
+
+void benchIngest(size_t n) {
+    std::vector<File> files = makeNamedFiles(n);
+    std::cout << "[ingest] " << n << " realistic file names" << std::endl;
+
+    double best = std::numeric_limits<double>::max();
+    size_t allocations = 0;
+    for (int round = 0; round < 3; round++) {
+        FileTrie trie;
+        size_t before = g_allocations;
+        auto start = Clock::now();
+        for (File& f : files) { trie.addFile(&f); }
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        best = std::min(best, elapsed.count());
+        allocations = g_allocations - before;
+    }
+    std::cout << "  addFile one by one: " << static_cast<size_t>(n / best) << " files/s, "
+              << allocations / n << " allocations/file" << std::endl;
+
+    std::vector<File*> pointers;
+    for (File& f : files) { pointers.push_back(&f); }
+    best = std::numeric_limits<double>::max();
+    for (int round = 0; round < 3; round++) {
+        FileTrie trie;
+        auto start = Clock::now();
+        trie.addFiles(pointers.begin(), pointers.end());
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    std::cout << "  addFiles (sorted batch): " << static_cast<size_t>(n / best) << " files/s" << std::endl;
+}
+
+void benchGlob(size_t n) {
+    std::vector<File> files = makeNamedFiles(n);
+    std::cout << "[glob] " << n << " realistic file names" << std::endl;
+
+    size_t bytes = g_allocated_bytes;
+    auto start = Clock::now();
+    FileNameIndex index;
+    for (File& f : files) { index.addFile(&f); }
+    std::chrono::duration<double, std::milli> build = Clock::now() - start;
+    std::cout << "  build " << build.count() << " ms, " << (g_allocated_bytes - bytes) / n << " bytes/file" << std::endl;
+
+    // What callers do without an index: lower case every name and match it
+    auto scan = [&](const std::string& pattern, bool glob) {
+        std::string p = pattern;
+        std::transform(p.begin(), p.end(), p.begin(), [](unsigned char c) { return std::tolower(c); });
+        std::unordered_set<File*> result;
+        for (File& f : files) {
+            std::string name = f.getName();
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+            if (glob ? FileNameIndex::globMatch(p, name) : name.find(p) != std::string::npos) { result.insert(&f); }
+        }
+        return result;
+    };
+
+    const std::vector<std::pair<std::string, bool>> queries = {
+        {"*.log", true}, {"*.TXT", true}, {"*report*", true}, {"img*.jpg", true}, {"*draft*v?.pdf", true},
+        {"*mee*", true}, {"?????.*", true}, {"budget", false}, {"ort2", false}, {"g2", false}, {"qqq", false}};
+    for (const auto& [pattern, glob] : queries) {
+        std::unordered_set<File*> expected = scan(pattern, glob);
+        if ((glob ? index.getFilesMatching(pattern) : index.getFilesContaining(pattern)) != expected) {
+            std::cerr << "[glob] results differ for " << pattern << std::endl;
+            std::exit(1);
+        }
+        size_t reps = std::max<size_t>(5, 200000 / (expected.size() + 100));
+        double indexed = timeMicros(reps, [&] {
+            if (glob) { index.getFilesMatching(pattern); } else { index.getFilesContaining(pattern); }
+        });
+        double linear = timeMicros(5, [&] { scan(pattern, glob); });
+        std::cout << "  " << (glob ? "glob " : "substring ") << pattern << " (" << expected.size() << " hits): index "
+                  << indexed << " us, linear scan " << linear << " us" << std::endl;
+    }
+}
+
+void benchFuzzy(size_t n) {
+    std::vector<File> files = makeNamedFiles(n);
+    FileTrie trie;
+    for (File& f : files) { trie.addFile(&f); }
+    std::cout << "[fuzzy] " << n << " realistic file names" << std::endl;
+
+    // The definition, checked by brute force: the best edit distance from the query to any prefix of the name
+    auto distance = [](const std::string& query, std::string name) {
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        std::vector<size_t> row(query.size() + 1), next(query.size() + 1);
+        for (size_t j = 0; j <= query.size(); j++) { row[j] = j; }
+        size_t best = row.back();
+        for (char c : name) {
+            next[0] = row[0] + 1;
+            for (size_t j = 1; j <= query.size(); j++) {
+                next[j] = std::min({row[j] + 1, next[j - 1] + 1, row[j - 1] + (query[j - 1] != c)});
+            }
+            row.swap(next);
+            best = std::min(best, row.back());
+        }
+        return best;
+    };
+
+    for (size_t d : {1, 2}) {
+        for (std::string query : {"reprot", "quartrly", "invioce2", "meetingsumary", "thesus"}) {
+            std::unordered_set<File*> found = trie.getFilesWithFuzzyPrefix(query, d);
+            if (n <= 100000) {
+                std::unordered_set<File*> expected;
+                for (File& f : files) {
+                    if (distance(query, f.getName()) <= d) { expected.insert(&f); }
+                }
+                if (found != expected) {
+                    std::cerr << "[fuzzy] results differ for " << query << " at distance " << d << std::endl;
+                    std::exit(1);
+                }
+            }
+            double micros = timeMicros(50, [&] { trie.getFilesWithFuzzyPrefix(query, d); });
+            std::cout << "  \"" << query << "\" d=" << d << " (" << found.size() << " hits): " << micros << " us"
+                      << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief Runs one writer (which returns the number of writes it made once told to stop) alongside readers threads
+ *      (each calling read, which returns false on a wrong answer) for the given time
+ *
+ * @return The total number of reads completed (or 0 if any read was wrong), and of writes
+ */
+std::pair<size_t, size_t> runConcurrently(size_t readers, std::chrono::milliseconds duration,
+                                          const std::function<size_t(std::atomic<bool>&)>& write,
+                                          const std::function<bool(std::mt19937&)>& read) {
+    std::atomic<bool> stop{false}, failed{false};
+    std::atomic<size_t> reads{0};
+    size_t writes = 0;
+    std::vector<std::thread> threads;
+    threads.emplace_back([&] { writes = write(stop); });
+    for (size_t t = 0; t < readers; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            size_t done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (!read(rng)) { failed = true; }
+                done++;
+            }
+            reads += done;
+        });
+    }
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (std::thread& t : threads) { t.join(); }
+    return {failed ? 0 : reads.load(), writes};
+}
+
+void benchConcurrent(size_t n) {
+    const size_t max_size = 100000;
+    std::vector<File> files = makeFiles(n, max_size);
+    std::vector<File> named = makeNamedFiles(n);
+    std::cout << "[concurrent] " << n << " files, one writer alongside 1-64 readers ("
+              << std::thread::hardware_concurrency() << " hardware threads)" << std::endl;
+
+    // Readers check every answer is a consistent snapshot: in range, in order, and never missing a file
+    // that was in the tree before the query began
+    auto checkRange = [&](const std::vector<File*>& found, size_t lo, size_t hi) {
+        for (size_t i = 0; i < found.size(); i++) {
+            size_t size = found[i]->getSize();
+            if (size < lo || size > hi || (i > 0 && size < found[i - 1]->getSize())) { return false; }
+        }
+        return true;
+    };
+
+    // Stress: the writer inserts every file, then removes every other one, while readers query
+    ConcurrentFileAVL tree;
+    std::atomic<size_t> inserted{0};
+    size_t reads = runConcurrently(4, std::chrono::milliseconds(1000), [&](std::atomic<bool>&) {
+        for (File& f : files) {
+            tree.insert(&f);
+            inserted.store(&f - files.data() + 1, std::memory_order_release);
+        }
+        for (size_t i = 0; i < files.size(); i += 2) { tree.remove(&files[i]); }
+        return files.size();
+    }, [&](std::mt19937& rng) {
+        size_t lo = rng() % max_size, hi = lo + rng() % 2000;
+        size_t floor = inserted.load(std::memory_order_acquire);
+        std::vector<File*> found = tree.query(lo, hi);
+        if (!checkRange(found, lo, hi)) { return false; }
+        // Files with an odd index are never removed, so once inserted they must be seen
+        std::unordered_set<File*> seen(found.begin(), found.end());
+        for (size_t i = 1; i < floor; i += 2) {
+            size_t size = files[i].getSize();
+            if (size >= lo && size <= hi && !seen.count(&files[i])) { return false; }
+        }
+        return true;
+    }).first;
+    FileAVL expected;
+    for (size_t i = 1; i < files.size(); i += 2) { expected.insert(&files[i]); }
+    std::vector<File*> all = tree.query(0, max_size), want = expected.query(0, max_size);
+    std::sort(all.begin(), all.end());
+    std::sort(want.begin(), want.end());
+    if (reads == 0 || all != want || tree.size() != want.size()) {
+        std::cerr << "[concurrent] ConcurrentFileAVL stress test failed" << std::endl;
+        std::exit(1);
+    }
+
+    ConcurrentFileTrie trie;
+    std::atomic<size_t> added{0};
+    reads = runConcurrently(4, std::chrono::milliseconds(1000), [&](std::atomic<bool>&) {
+        for (File& f : named) {
+            trie.addFile(&f);
+            added.store(&f - named.data() + 1, std::memory_order_release);
+        }
+        return named.size();
+    }, [&](std::mt19937& rng) {
+        size_t floor = added.load(std::memory_order_acquire);
+        if (floor == 0) { return true; }
+        // Every added file must be found by its own first three characters
+        const File& f = named[rng() % floor];
+        std::string prefix = f.getName().substr(0, 3);
+        std::unordered_set<File*> found = trie.getFilesWithPrefix(prefix);
+        return found.count(const_cast<File*>(&f)) == 1 && trie.countWithPrefix(prefix) >= found.size();
+    }).first;
+    FileTrie reference;
+    for (File& f : named) { reference.addFile(&f); }
+    for (std::string prefix : {"r", "Rep", "img0", "quarterlyr", "zzz"}) {
+        if (trie.getFilesWithPrefix(prefix) != reference.getFilesWithPrefix(prefix)
+                || trie.countWithPrefix(prefix) != reference.countWithPrefix(prefix)) { reads = 0; }
+    }
+    if (trie.getFilesWithFuzzyPrefix("rpe", 1) != reference.getFilesWithFuzzyPrefix("rpe", 1)) { reads = 0; }
+    if (reads == 0) {
+        std::cerr << "[concurrent] ConcurrentFileTrie stress test failed" << std::endl;
+        std::exit(1);
+    }
+    std::cout << "  stress tests passed" << std::endl;
+
+    // Scaling: queries per second with a writer continuously inserting and removing, against one global mutex
+    FileAVL locked;
+    std::mutex global;
+    for (File& f : files) {
+        locked.insert(&f);
+        tree.insert(&f);
+    }
+    auto churn = [&](auto& insert, auto& remove) {
+        return [&](std::atomic<bool>& stop) {
+            size_t writes = 0;
+            for (size_t i = 0; !stop; i = (i + 1) % files.size(), writes += 2) {
+                remove(&files[i]);
+                insert(&files[i]);
+            }
+            return writes;
+        };
+    };
+    auto lockedInsert = [&](File* f) { std::lock_guard<std::mutex> lock(global); locked.insert(f); };
+    auto lockedRemove = [&](File* f) { std::lock_guard<std::mutex> lock(global); locked.remove(f); };
+    auto sharedInsert = [&](File* f) { tree.insert(f); };
+    auto sharedRemove = [&](File* f) { tree.remove(f); };
+    auto lockedWriter = churn(lockedInsert, lockedRemove);
+    auto sharedWriter = churn(sharedInsert, sharedRemove);
+
+    const std::chrono::milliseconds slice(200);
+    for (size_t readers : {1, 2, 4, 8, 16, 32, 64}) {
+        auto [mutex_reads, mutex_writes] = runConcurrently(readers, slice, lockedWriter, [&](std::mt19937& rng) {
+            size_t lo = rng() % max_size;
+            std::lock_guard<std::mutex> lock(global);
+            return locked.query(lo, lo + 200).size() < n;
+        });
+        auto [shared_reads, shared_writes] = runConcurrently(readers, slice, sharedWriter, [&](std::mt19937& rng) {
+            size_t lo = rng() % max_size;
+            return tree.query(lo, lo + 200).size() < n;
+        });
+        std::cout << "  " << readers << " readers: global mutex FileAVL " << mutex_reads * 1000 / slice.count()
+                  << " queries/s + " << mutex_writes * 1000 / slice.count() << " writes/s, ConcurrentFileAVL "
+                  << shared_reads * 1000 / slice.count() << " queries/s + " << shared_writes * 1000 / slice.count()
+                  << " writes/s" << std::endl;
+    }
+}
+
+void benchPersistent(size_t n) {
+    const size_t max_size = 16384;
+    std::vector<File> files = makeFiles(n, max_size);
+    std::cout << "[persistent] " << n << " files, sizes in [0, " << max_size << ")" << std::endl;
+
+    // Keep a snapshot every n/8 inserts, then remove half the files: every snapshot must still read as it was
+    PersistentFileAVL tree;
+    FileAVL live;
+    std::vector<std::pair<PersistentFileAVL, std::vector<File*>>> snapshots;
+    auto start = Clock::now();
+    for (size_t i = 0; i < files.size(); i++) {
+        tree = tree.insert(&files[i]);
+        if (i % (n / 8 + 1) == 0) { snapshots.emplace_back(tree, std::vector<File*>()); }
+    }
+    std::chrono::duration<double, std::milli> building = Clock::now() - start;
+    for (size_t i = 0; i < files.size(); i += 2) { tree = tree.remove(&files[i]); }
+
+    for (auto& [snapshot, expected] : snapshots) {
+        FileAVL reference;
+        for (size_t i = 0; i < snapshot.size(); i++) { reference.insert(&files[i]); }
+        std::vector<File*> got = snapshot.query(0, max_size), want = reference.query(0, max_size);
+        std::sort(got.begin(), got.end());
+        std::sort(want.begin(), want.end());
+        if (got != want) {
+            std::cerr << "[persistent] a snapshot changed after later writes" << std::endl;
+            std::exit(1);
+        }
+    }
+    for (size_t i = 1; i < files.size(); i += 2) { live.insert(&files[i]); }
+    if (tree.query(max_size / 4, max_size / 2).size() != live.query(max_size / 4, max_size / 2).size()
+        || tree.size() != static_cast<size_t>(live.size())) {
+        std::cerr << "[persistent] latest version disagrees with FileAVL" << std::endl;
+        std::exit(1);
+    }
+
+    FileAVL mutable_tree;
+    start = Clock::now();
+    for (File& f : files) { mutable_tree.insert(&f); }
+    std::chrono::duration<double, std::milli> mutable_building = Clock::now() - start;
+    std::cout << "  build by insert: FileAVL " << mutable_building.count() << " ms, PersistentFileAVL "
+              << building.count() << " ms" << std::endl;
+
+    // What a point-in-time view used to cost: copying the tree out, versus sharing it
+    PersistentFileAVL full;
+    for (File& f : files) { full = full.insert(&f); }
+    size_t sink = 0;
+    double frozen = timeMicros(20, [&] { sink += mutable_tree.freeze().size(); });
+    double copied = timeMicros(20, [&] { sink += mutable_tree.query(0, max_size).size(); });
+    double shared = timeMicros(1000000, [&] { PersistentFileAVL snapshot = full; sink += snapshot.size(); });
+    std::cout << "  snapshot: freeze() " << frozen << " us, query() copy " << copied << " us, PersistentFileAVL copy "
+              << shared << " us (" << sink % 2 << ")" << std::endl;
+
+    // A write on top of a snapshot only pays for the path it copies
+    const size_t writes = std::min<size_t>(1000, n);
+    size_t allocations = g_allocations, bytes = g_allocated_bytes;
+    for (size_t i = 0; i < writes; i++) {
+        PersistentFileAVL next = full.remove(&files[i]).insert(&files[i]);
+        sink += next.size();
+    }
+    std::cout << "  remove + insert on a snapshot: " << (g_allocations - allocations) / writes << " allocations, "
+              << (g_allocated_bytes - bytes) / writes << " bytes each (" << sink % 2 << ")" << std::endl;
+}
+
+void benchBatch(size_t n) {
+    const size_t max_size = 16384;
+    std::vector<File> files = makeFiles(n, max_size);
+    FileAVL tree;
+    for (File& f : files) { tree.insert(&f); }
+
+    std::mt19937 rng(18);
+    std::vector<std::pair<size_t, size_t>> ranges(10000);
+    for (auto& [lo, hi] : ranges) {
+        lo = rng() % max_size;
+        hi = lo + rng() % (max_size / 64);
+        if (rng() % 4 == 0) { std::swap(lo, hi); }
+    }
+    std::cout << "[batch] " << n << " files, " << ranges.size() << " queries ("
+              << std::thread::hardware_concurrency() << " hardware threads)" << std::endl;
+
+    RangeBatch batch = tree.queryBatch(ranges);
+    RangeBatch split = tree.queryBatch(ranges, 4);
+    if (split.files_ != batch.files_ || split.offsets_ != batch.offsets_) {
+        std::cerr << "[batch] answers differ across threads" << std::endl;
+        std::exit(1);
+    }
+    for (size_t i = 0; i < ranges.size(); i++) {
+        std::vector<File*> expected = tree.query(ranges[i].first, ranges[i].second);
+        if (batch.size() != ranges.size() || !std::equal(expected.begin(), expected.end(), batch[i].begin(), batch[i].end())) {
+            std::cerr << "[batch] answer " << i << " differs from query()" << std::endl;
+            std::exit(1);
+        }
+    }
+
+    size_t sink = 0;
+    double looped = timeMicros(3, [&] {
+        for (auto& [lo, hi] : ranges) { sink += tree.query(lo, hi).size(); }
+    });
+    std::cout << "  query() in a loop: " << static_cast<size_t>(ranges.size() / looped * 1e6) << " queries/s, "
+              << static_cast<size_t>(batch.files_.size() / looped) << " files/us" << std::endl;
+    for (size_t threads : {1, 2, 4, 8, 16}) {
+        double batched = timeMicros(3, [&] { sink += tree.queryBatch(ranges, threads).files_.size(); });
+        std::cout << "  queryBatch, " << threads << " threads: " << static_cast<size_t>(ranges.size() / batched * 1e6)
+                  << " queries/s, " << static_cast<size_t>(batch.files_.size() / batched) << " files/us" << std::endl;
+    }
+    std::cout << "  (" << sink % 2 << ")" << std::endl;
+}
+
+void benchMapped(size_t n) {
+    const size_t max_size = 4096;
+    std::vector<File> files = makeFiles(n, max_size);
+    FileAVL tree;
+    FileTrie trie;
+    for (File& f : files) {
+        tree.insert(&f);
+        trie.addFile(&f);
+    }
+    std::string path = (std::filesystem::temp_directory_path() / "bench_index.fidx").string();
+    std::cout << "[mapped] " << n << " files, sizes in [0, " << max_size << ")" << std::endl;
+
+    auto start = Clock::now();
+    MappedFileIndex::write(path, tree, 42);
+    std::chrono::duration<double, std::milli> writing = Clock::now() - start;
+
+    // What startup costs today: rebuild every File and insert it into both indexes
+    std::vector<std::pair<std::string, size_t>> listing;
+    for (File& f : files) { listing.emplace_back(f.getName(), f.getSize()); }
+    start = Clock::now();
+    {
+        std::vector<File> rebuilt;
+        rebuilt.reserve(listing.size());
+        FileAVL t;
+        FileTrie p;
+        for (auto& [name, size] : listing) {
+            rebuilt.emplace_back(name, std::string(size, 'x'));
+            t.insert(&rebuilt.back());
+            p.addFile(&rebuilt.back());
+        }
+    }
+    std::chrono::duration<double, std::milli> rebuilding = Clock::now() - start;
+
+    start = Clock::now();
+    MappedFileIndex verified(path);
+    std::chrono::duration<double, std::milli> opening = Clock::now() - start;
+    start = Clock::now();
+    MappedFileIndex trusted(path, false);
+    std::chrono::duration<double, std::milli> mapping = Clock::now() - start;
+
+    auto same = [](const std::vector<MappedFile>& got, std::vector<File*> want) {
+        std::vector<std::pair<std::string, size_t>> a, b;
+        for (const MappedFile& m : got) { a.emplace_back(m.name_, m.size_); }
+        for (File* f : want) { b.emplace_back(f->getName(), f->getSize()); }
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        return a == b;
+    };
+    bool ok = verified.size() == files.size() && verified.sequence() == 42;
+    for (size_t lo : {size_t{0}, size_t{100}, max_size - 1}) {
+        for (size_t hi : {lo, lo + 50, max_size * 2}) {
+            ok = ok && same(verified.query(lo, hi), tree.query(lo, hi)) && same(trusted.query(hi, lo), tree.query(lo, hi));
+        }
+    }
+    for (std::string prefix : {"f", "F1", "f123", "f99999", "g"}) {
+        std::unordered_set<File*> found = trie.getFilesWithPrefix(prefix);
+        ok = ok && same(verified.getFilesWithPrefix(prefix), std::vector<File*>(found.begin(), found.end()));
+    }
+    if (!ok) {
+        std::cerr << "[mapped] the mapped index disagrees with FileAVL / FileTrie" << std::endl;
+        std::exit(1);
+    }
+
+    // A flipped byte anywhere in the file has to be caught
+    std::string corrupt = path + ".corrupt";
+    std::filesystem::copy_file(path, corrupt, std::filesystem::copy_options::overwrite_existing);
+    for (size_t offset : {size_t{3}, size_t{20}, std::filesystem::file_size(path) - 1}) {
+        std::fstream io(corrupt, std::ios::in | std::ios::out | std::ios::binary);
+        io.seekg(offset);
+        char c = static_cast<char>(io.get() ^ 0x20);
+        io.seekp(offset);
+        io.put(c);
+        io.close();
+        try {
+            MappedFileIndex broken(corrupt);
+            std::cerr << "[mapped] corruption at byte " << offset << " went unnoticed" << std::endl;
+            std::exit(1);
+        } catch (const InvalidFormatException&) {}
+        std::filesystem::copy_file(path, corrupt, std::filesystem::copy_options::overwrite_existing);
+    }
+
+    // A write that cannot replace its target (here a non-empty directory) leaves no temporary file behind
+    std::filesystem::path blocked = std::filesystem::temp_directory_path() / "bench_index_blocked";
+    std::filesystem::create_directories(blocked / "keep");
+    try {
+        MappedFileIndex::write(blocked.string(), tree);
+        std::cerr << "[mapped] writing over a directory did not fail" << std::endl;
+        std::exit(1);
+    } catch (const std::runtime_error&) {}
+    if (std::filesystem::exists(blocked.string() + ".tmp")) {
+        std::cerr << "[mapped] a failed write left its temporary file behind" << std::endl;
+        std::exit(1);
+    }
+    std::filesystem::remove_all(blocked);
+
+    size_t sink = 0;
+    double querying = timeMicros(10000, [&] { sink += verified.query(1000, 1010).size(); });
+    double prefixing = timeMicros(10000, [&] { sink += verified.getFilesWithPrefix("f1234").size(); });
+    std::cout << "  write " << writing.count() << " ms, " << std::filesystem::file_size(path) / files.size()
+              << " bytes/file" << std::endl;
+    std::cout << "  startup: rebuild File + FileAVL + FileTrie " << rebuilding.count() << " ms, open verified "
+              << opening.count() << " ms, open header-only " << mapping.count() << " ms" << std::endl;
+    std::cout << "  query(1000, 1010) " << querying << " us, getFilesWithPrefix(\"f1234\") " << prefixing << " us ("
+              << sink % 2 << ")" << std::endl;
+    std::remove(path.c_str());
+    std::remove(corrupt.c_str());
+}
+
+/**
+ * @brief The change a kill-and-recover run makes with each LSN, so the expected contents can be recomputed from the LSN alone.
+ *    Sizes are drawn from a handful of values, so that files share a name, and sometimes a name and size too.
+ */
+void walChange(FileIndexLog& log, uint64_t lsn) {
+    std::string name = "file" + std::to_string(lsn % 5000) + ".txt";
+    if (lsn % 10 < 6) {
+        log.addFile(name, lsn % 3);
+    } else if (lsn % 10 < 8) {
+        log.resizeFile(name, lsn % 3, lsn % 7);
+    } else {
+        log.removeFile(name, lsn % 3);
+    }
+}
+
+std::multiset<std::pair<std::string, size_t>> walExpected(uint64_t last) {
+    std::multiset<std::pair<std::string, size_t>> files;
+    for (uint64_t lsn = 1; lsn <= last; lsn++) {
+        std::string name = "file" + std::to_string(lsn % 5000) + ".txt";
+        auto found = files.find({name, lsn % 3});
+        if (lsn % 10 < 6) {
+            files.insert({name, lsn % 3});
+        } else if (found != files.end()) {
+            files.erase(found);
+            if (lsn % 10 < 8) { files.insert({name, lsn % 7}); }
+        }
+    }
+    return files;
+}
+
+void benchWal(size_t n) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "bench_wal";
+    std::filesystem::remove_all(dir);
+    std::cout << "[wal] write-ahead log in " << dir.string() << std::endl;
+
+    // Kill a writer at a random moment, several times over, and check nothing it was told is durable went missing
+    std::mt19937 rng(20);
+    for (int round = 0; round < 4; round++) {
+        int pipe_fds[2];
+        if (::pipe(pipe_fds) != 0) { std::perror("pipe"); std::exit(1); }
+        pid_t child = ::fork();
+        if (child == 0) {
+            ::close(pipe_fds[0]);
+            FileIndexLog log(dir.string(), 16 << 10);
+            for (uint64_t lsn = log.lastLsn() + 1;; lsn++) {
+                walChange(log, lsn);
+                if (lsn % 16 == 0) {
+                    log.sync();
+                    if (::write(pipe_fds[1], &lsn, sizeof(lsn)) != sizeof(lsn)) { ::_exit(1); }
+                }
+            }
+        }
+        ::close(pipe_fds[1]);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50 + rng() % 200));
+        ::kill(child, SIGKILL);
+        ::waitpid(child, nullptr, 0);
+
+        uint64_t acknowledged = 0, lsn;
+        while (::read(pipe_fds[0], &lsn, sizeof(lsn)) == sizeof(lsn)) { acknowledged = lsn; }
+        ::close(pipe_fds[0]);
+
+        // A torn write at the end of the log has to be ignored too
+        if (round % 2 == 1) {
+            std::ofstream(dir / "changes.log", std::ios::app | std::ios::binary) << std::string("\x19\0\0\0garbage", 11);
+        }
+
+        auto start = Clock::now();
+        FileIndexLog recovered(dir.string(), 16 << 10);
+        std::chrono::duration<double, std::milli> recovering = Clock::now() - start;
+        std::vector<std::pair<std::string, size_t>> files = recovered.files();
+        std::multiset<std::pair<std::string, size_t>> got(files.begin(), files.end());
+        if (recovered.lastLsn() < acknowledged || got != walExpected(recovered.lastLsn()) || recovered.size() != got.size()) {
+            std::cerr << "[wal] recovery lost acknowledged changes (acknowledged " << acknowledged << ", recovered "
+                      << recovered.lastLsn() << ")" << std::endl;
+            std::exit(1);
+        }
+        std::cout << "  killed after " << acknowledged << " acknowledged changes: recovered " << recovered.lastLsn()
+                  << " (" << got.size() << " files) in " << recovering.count() << " ms" << std::endl;
+    }
+
+    // The recovered files rebuild a FileAVL and a FileTrie that agree with the log
+    {
+        FileIndexLog recovered(dir.string(), 16 << 10);
+        std::deque<File> files;
+        FileAVL tree;
+        FileTrie trie;
+        auto start = Clock::now();
+        size_t made = recovered.rebuild(files, tree, trie);
+        std::chrono::duration<double, std::milli> rebuilding = Clock::now() - start;
+        if (made != recovered.size() || tree.query(0, 7).size() != made || trie.countWithPrefix("file") != made) {
+            std::cerr << "[wal] rebuild made " << made << " of " << recovered.size() << " files" << std::endl;
+            std::exit(1);
+        }
+        std::cout << "  rebuilt FileAVL + FileTrie from " << made << " files in " << rebuilding.count() << " ms" << std::endl;
+    }
+
+    // A compaction that cannot write its snapshot must neither lose the log it set aside nor fail sync()
+    std::filesystem::remove_all(dir);
+    {
+        std::filesystem::create_directories(dir / "snapshot.fidx.tmp");
+        std::vector<std::string> added;
+        bool compaction_failed = false;
+        {
+            FileIndexLog log(dir.string(), 200);
+            for (size_t i = 0; i < 40; i++) {
+                added.push_back("blocked" + std::to_string(i) + ".txt");
+                log.sync(log.addFile(added.back(), i));
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                compaction_failed = compaction_failed || log.compactionError();
+            }
+        }
+        std::filesystem::remove_all(dir / "snapshot.fidx.tmp");
+        FileIndexLog recovered(dir.string(), 200);
+        std::vector<std::pair<std::string, size_t>> files = recovered.files();
+        std::map<std::string, size_t> got(files.begin(), files.end());
+        bool all_there = got.size() == added.size();
+        for (size_t i = 0; i < added.size() && all_there; i++) { all_there = got.count(added[i]) && got[added[i]] == i; }
+        if (!compaction_failed || !all_there || recovered.compactionError()) {
+            std::cerr << "[wal] failed compactions lost acknowledged changes (" << got.size() << " of " << added.size()
+                      << " recovered)" << std::endl;
+            std::exit(1);
+        }
+        std::cout << "  snapshot writes failing: all " << added.size() << " acknowledged changes recovered" << std::endl;
+    }
+
+    // Group commit: every writer waits for its own change, but concurrent waiters share each fsync
+    std::filesystem::remove_all(dir);
+    for (size_t threads : {1, 4, 16}) {
+        FileIndexLog log(dir.string());
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> commits{0};
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < threads; t++) {
+            writers.emplace_back([&, t] {
+                for (size_t i = 0; !stop; i++) {
+                    log.sync(log.addFile("w" + std::to_string(t) + "f" + std::to_string(i) + ".txt", i));
+                    commits++;
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        stop = true;
+        for (std::thread& w : writers) { w.join(); }
+        std::cout << "  " << threads << " writers each waiting for their own change: " << commits * 2 << " commits/s" << std::endl;
+    }
+
+    // Appends that do not wait are batched into large sequential writes
+    std::filesystem::remove_all(dir);
+    {
+        FileIndexLog log(dir.string());
+        auto start = Clock::now();
+        for (size_t i = 0; i < n; i++) { log.addFile("f" + std::to_string(i) + ".txt", i); }
+        log.sync();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        std::cout << "  " << n << " changes then one sync: " << static_cast<size_t>(n / elapsed.count()) << " changes/s" << std::endl;
+    }
+    std::filesystem::remove_all(dir);
+}
+
+void benchFiles(size_t n) {
+    const size_t content_bytes = 4096;
+    std::cout << "[files] " << n << " files of " << content_bytes << " bytes through File -> FileAVL -> FileTrie" << std::endl;
+
+    // Reports the allocations and time one step of the ingestion path costs per file
+    auto step = [&](const std::string& name, const std::function<void()>& fn) {
+        size_t allocations = g_allocations, bytes = g_allocated_bytes;
+        auto start = Clock::now();
+        fn();
+        std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+        std::cout << "  " << name << ": " << static_cast<double>(g_allocations - allocations) / n << " allocations, "
+                  << (g_allocated_bytes - bytes) / n << " bytes, " << elapsed.count() / n << " us per file" << std::endl;
+    };
+
+    std::vector<std::string> names;
+    for (size_t i = 0; i < n; i++) { names.push_back("report" + std::to_string(i) + ".txt"); }
+
+    std::vector<File> files;
+    files.reserve(n);
+    step("construct", [&] {
+        for (const std::string& name : names) { files.emplace_back(name, std::string(content_bytes, 'x')); }
+    });
+    std::vector<File> copies;
+    copies.reserve(n);
+    step("copy", [&] { copies.assign(files.begin(), files.end()); });
+    step("copy assign", [&] { for (size_t i = 0; i < n; i++) { copies[i] = files[n - 1 - i]; } });
+
+    FileAVL tree;
+    step("FileAVL insert", [&] { for (File& f : files) { tree.insert(&f); } });
+    FileTrie trie;
+    step("FileTrie addFile", [&] { for (File& f : files) { trie.addFile(&f); } });
+
+    std::vector<File*> order;
+    for (File& f : files) { order.push_back(&f); }
+    std::shuffle(order.begin(), order.end(), std::mt19937(21));
+    step("sort by operator<", [&] { std::sort(order.begin(), order.end(), [](File* a, File* b) { return *a < *b; }); });
+
+    size_t total = 0;
+    step("read contents", [&] { for (File& f : files) { total += f.getContents().size(); } });
+    std::ostream discard(nullptr);
+    step("operator<<", [&] { for (File& f : files) { discard << f; } });
+
+    if (total != n * content_bytes || !std::is_sorted(order.begin(), order.end(), [](File* a, File* b) { return *a < *b; })) {
+        std::cerr << "[files] ingestion produced the wrong result" << std::endl;
+        std::exit(1);
+    }
+}
+
+void benchIcons(size_t n) {
+    const size_t distinct = 12, dim = IconPool::ICON_DIM;
+    std::cout << "[icons] " << n << " files sharing " << distinct << " distinct icons" << std::endl;
+
+    // Each caller hands over its own new[] array, as File's interface asks
+    auto makeIcon = [&](size_t kind) {
+        int* icon = new int[dim];
+        for (size_t p = 0; p < dim; p++) { icon[p] = static_cast<int>((kind * 37 + p * 11) & 0xFF); }
+        return icon;
+    };
+
+    auto step = [&](const std::string& name, const std::function<void()>& fn) {
+        size_t allocations = g_allocations, bytes = g_allocated_bytes;
+        auto start = Clock::now();
+        fn();
+        std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+        std::cout << "  " << name << ": " << static_cast<double>(g_allocations - allocations) / n << " allocations, "
+                  << (g_allocated_bytes - bytes) / n << " bytes, " << elapsed.count() / n << " us per file" << std::endl;
+    };
+
+    std::vector<File> files;
+    files.reserve(n);
+    step("construct with icon", [&] {
+        for (size_t i = 0; i < n; i++) { files.emplace_back("icon" + std::to_string(i) + ".png", "", makeIcon(i % distinct)); }
+    });
+    std::cout << "  icons held: " << IconPool::distinct() << " (" << IconPool::distinct() * dim << " bytes, "
+              << static_cast<double>(IconPool::distinct() * dim) / n << " bytes per file; "
+              << dim * sizeof(int) << " per file when every File owned its own array)" << std::endl;
+
+    std::vector<File> copies;
+    copies.reserve(n);
+    step("copy", [&] { copies.assign(files.begin(), files.end()); });
+    step("copy assign", [&] { for (size_t i = 0; i < n; i++) { copies[i] = files[n - 1 - i]; } });
+    step("setIcon", [&] { for (size_t i = 0; i < n; i++) { files[i].setIcon(makeIcon((i + 1) % distinct)); } });
+
+    // Every File with the same icon must point at the same pixels, and those pixels must be the ones it was given
+    bool correct = IconPool::distinct() == distinct;
+    std::unordered_set<const uint8_t*> shared;
+    for (size_t i = 0; i < n && correct; i++) {
+        const uint8_t* icon = files[i].getIcon();
+        const uint8_t* copied = copies[i].getIcon();
+        size_t kind = (i + 1) % distinct, copied_kind = (n - 1 - i) % distinct;
+        for (size_t p = 0; p < dim; p++) {
+            correct = correct && icon[p] == ((kind * 37 + p * 11) & 0xFF) && copied[p] == ((copied_kind * 37 + p * 11) & 0xFF);
+        }
+        shared.insert(icon);
+        shared.insert(copied);
+    }
+    correct = correct && shared.size() == distinct;
+    files.clear();
+    copies.clear();
+    if (!correct || IconPool::distinct() != 0) {
+        std::cerr << "[icons] files did not share the right icons" << std::endl;
+        std::exit(1);
+    }
+}
+
+void benchContents(size_t n) {
+    const size_t count = std::min<size_t>(n, 2000), content_bytes = 128 << 10;
+    std::cout << "[contents] copying " << count << " files of " << (content_bytes >> 10) << " KiB" << std::endl;
+
+    auto step = [&](const std::string& name, const std::function<void()>& fn) {
+        size_t allocations = g_allocations, bytes = g_allocated_bytes;
+        auto start = Clock::now();
+        fn();
+        std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+        std::cout << "  " << name << ": " << static_cast<double>(g_allocations - allocations) / count << " allocations, "
+                  << (g_allocated_bytes - bytes) / count << " bytes, " << elapsed.count() / count << " us per file" << std::endl;
+    };
+
+    std::vector<File> files;
+    files.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        files.emplace_back("page" + std::to_string(i) + ".html", std::string(content_bytes, static_cast<char>('a' + i % 26)));
+    }
+
+    // Each pipeline stage copies the whole batch; only the last one changes anything
+    std::vector<File> queued, snapshot;
+    step("copy vector", [&] { queued = files; });
+    step("copy vector again", [&] { snapshot = queued; });
+    step("copy assign", [&] { for (size_t i = 0; i < count; i++) { snapshot[i] = files[count - 1 - i]; } });
+    size_t total = 0;
+    step("getSize", [&] { for (const File& f : snapshot) { total += f.getSize(); } });
+    step("append to shared", [&] { for (File& f : queued) { f.appendContents("<!-- seen -->"); } });
+    step("append to unshared", [&] { for (File& f : queued) { f.appendContents("<!-- seen -->"); } });
+    step("set contents", [&] { for (File& f : snapshot) { f.setContents("moved"); } });
+
+    // The copies that were not changed must still hold the original contents
+    bool correct = total == count * content_bytes;
+    for (size_t i = 0; i < count && correct; i++) {
+        const std::string& original = files[i].getContents();
+        const std::string& changed = queued[i].getContents();
+        correct = original.size() == content_bytes && original.back() == static_cast<char>('a' + i % 26)
+            && changed.size() == content_bytes + 26 && changed.compare(0, content_bytes, original) == 0
+            && snapshot[i].getContents() == "moved";
+    }
+    if (!correct) {
+        std::cerr << "[contents] a change to one copy leaked into another" << std::endl;
+        std::exit(1);
+    }
+}
+
+/**
+ * @brief Writes a tree of count files under dir (100 to a directory, two levels deep), the i-th of
+ *    file_bytes + i % spread bytes, plus a few entries the scanners must skip (names File rejects,
+ *    a symbolic link, and an empty directory) and one more file, in a directory whose name File would reject
+ * @return The number of files written with valid names
+ */
+size_t makeTree(const std::filesystem::path& dir, size_t count, size_t file_bytes, size_t spread = 1) {
+    std::filesystem::remove_all(dir);
+    std::string contents;
+    for (size_t i = 0; i < count; i++) {
+        std::filesystem::path sub = dir / ("d" + std::to_string(i / 1000)) / ("e" + std::to_string(i / 100));
+        if (i % 100 == 0) { std::filesystem::create_directories(sub); }
+        contents.assign(file_bytes + i % spread, 'x');
+        if (!contents.empty()) { contents[0] = static_cast<char>('a' + i % 26); }
+        std::ofstream(sub / ("log" + std::to_string(i) + ".txt"), std::ios::binary) << contents;
+    }
+    std::ofstream(dir / "bad-name.txt") << "skipped";
+    std::ofstream(dir / "two.dots.txt") << "skipped";
+    std::filesystem::create_directories(dir / "empty");
+    std::filesystem::create_directory_symlink(dir / "d0", dir / "loop");
+
+    // A directory's name need not be a valid File name: the file in it still counts
+    std::filesystem::create_directories(dir / "src-old.v1.2");
+    contents.assign(file_bytes + count % spread, 'x');
+    if (!contents.empty()) { contents[0] = static_cast<char>('a' + count % 26); }
+    std::ofstream(dir / "src-old.v1.2" / ("log" + std::to_string(count) + ".txt"), std::ios::binary) << contents;
+    return count + 1;
+}
+
+void benchScan(size_t n) {
+    const size_t count = std::min<size_t>(n, 20000), file_bytes = 16 << 10;
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "bench_scan";
+    size_t found = makeTree(dir, count, file_bytes);
+    std::cout << "[scan] indexing " << found << " files of " << (file_bytes >> 10) << " KiB on disk" << std::endl;
+
+    // The old way: read every file into a File, then insert it
+    std::deque<File> loaded;
+    FileAVL loaded_tree;
+    FileTrie loaded_trie;
+    size_t allocated = g_allocated_bytes;
+    double reading = timeMicros(1, [&] {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+            std::string name = entry.path().filename().string();
+            if (!entry.is_regular_file() || entry.is_symlink() || !File::isValidName(name)) { continue; }
+            std::ifstream in(entry.path(), std::ios::binary);
+            loaded.emplace_back(name, std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+            loaded_tree.insert(&loaded.back());
+            loaded_trie.addFile(&loaded.back());
+        }
+    });
+    size_t reading_bytes = g_allocated_bytes - allocated;
+
+    DirectoryScanner scanner(dir.string());
+    FileAVL tree;
+    FileTrie trie;
+    allocated = g_allocated_bytes;
+    double scanning = timeMicros(1, [&] { scanner.scan(tree, trie); });
+    size_t scanning_bytes = g_allocated_bytes - allocated;
+
+    std::cout << "  read contents: " << reading / found << " us, " << reading_bytes / found << " bytes per file" << std::endl;
+    std::cout << "  scan metadata: " << scanning / found << " us, " << scanning_bytes / found << " bytes per file ("
+              << scanner.skipped() << " entries skipped)" << std::endl;
+
+    // Contents are only mapped when asked for, and must match what is on disk
+    size_t total = 0;
+    double mapping = timeMicros(1, [&] {
+        for (const File& f : scanner.files()) { total += f.getContentsView().size(); }
+    });
+    std::cout << "  map contents on demand: " << mapping / found << " us per file" << std::endl;
+
+    bool correct = scanner.files().size() == found && scanner.skipped() == 2 && tree.size() == static_cast<int>(found)
+        && trie.countWithPrefix("log") == found && total == found * file_bytes && loaded.size() == found;
+    for (size_t i = 0; i < found && correct; i += found / 10 + 1) {
+        const File& f = scanner.files()[i];
+        std::string_view view = f.getContentsView();
+        size_t number = std::stoul(f.getName().substr(3));
+        correct = f.getSize() == file_bytes && view.size() == file_bytes && view[0] == static_cast<char>('a' + number % 26)
+            && f.getContents() == view && File(f).getContentsView().data() == view.data();
+    }
+    File changed = scanner.files().front();
+    changed.appendContents("!");
+    correct = correct && changed.getSize() == file_bytes + 1 && scanner.files().front().getSize() == file_bytes
+        && changed.getPath().empty() && !scanner.files().front().getPath().empty();
+
+    // The name rules must be exactly the constructor's
+    for (const char* name : {"a.b", "ab", "a.", ".a", "", "a.b.c", "a-b", "a b", "\xc3\xa9.txt"}) {
+        bool constructs = true;
+        try { File{name}; } catch (const InvalidFormatException&) { constructs = false; }
+        correct = correct && constructs == File::isValidName(name);
+    }
+    std::filesystem::remove_all(dir);
+    if (!correct) {
+        std::cerr << "[scan] the scanned files did not match the tree on disk" << std::endl;
+        std::exit(1);
+    }
+}
+
+void benchCrawl(size_t n) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "bench_crawl";
+    size_t count = makeTree(dir, n, 0, 512);
+    std::cout << "[crawl] indexing " << count << " files on disk (" << std::thread::hardware_concurrency()
+              << " hardware threads)" << std::endl;
+
+    // The serial baseline, and what every crawl must agree with
+    DirectoryScanner scanner(dir.string());
+    FileAVL expected_tree;
+    FileTrie expected_trie;
+    double serial = timeMicros(1, [&] { scanner.scan(expected_tree, expected_trie); });
+    std::cout << "  DirectoryScanner: " << count / serial * 1e6 << " files/sec" << std::endl;
+
+    std::multiset<std::pair<std::string, size_t>> expected;
+    for (const File& f : scanner.files()) { expected.emplace(f.getPath(), f.getSize()); }
+
+    bool correct = true;
+    for (size_t threads : {1, 2, 4, 8}) {
+        DirectoryCrawler crawler(dir.string(), threads);
+        FileAVL tree;
+        FileTrie trie;
+        double crawling = timeMicros(1, [&] { crawler.crawl(tree, trie); });
+        std::cout << "  DirectoryCrawler, " << threads << " threads: " << count / crawling * 1e6 << " files/sec" << std::endl;
+
+        std::multiset<std::pair<std::string, size_t>> found;
+        for (File* f : crawler.files()) { found.emplace(f->getPath(), f->getSize()); }
+        correct = correct && found == expected && crawler.skipped() == scanner.skipped()
+            && tree.size() == expected_tree.size() && tree.countInRange(0, 255) == expected_tree.countInRange(0, 255)
+            && trie.countWithPrefix("log1") == expected_trie.countWithPrefix("log1");
+    }
+
+    bool threw = false;
+    try { DirectoryCrawler((dir / "missing").string()).crawl(); } catch (const std::runtime_error&) { threw = true; }
+    std::filesystem::remove_all(dir);
+    if (!correct || !threw || expected.size() != count) {
+        std::cerr << "[crawl] the crawlers disagreed with the serial scan" << std::endl;
+        std::exit(1);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::string section = argc > 1 ? argv[1] : "all";
+    size_t n = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 50000;
+
+    bool ran = false;
+    auto run = [&](const std::string& name, void (*fn)(size_t)) {
+        if (section == "all" || section == name) {
+            fn(n);
+            ran = true;
+        }
+    };
+
+    run("range", benchRange);
+    run("stats", benchStats);
+    run("stream", benchStream);
+    run("update", benchUpdate);
+    run("bulk", benchBulk);
+    run("layout", benchLayout);
+    run("frozen", benchFrozen);
+    run("insert", benchInsert);
+    run("radix", benchRadix);
+    run("prefix", benchPrefix);
+    run("topk", benchTopK);
+    run("ingest", benchIngest);
+    run("glob", benchGlob);
+    run("fuzzy", benchFuzzy);
+    run("concurrent", benchConcurrent);
+    run("persistent", benchPersistent);
+    run("batch", benchBatch);
+    run("mapped", benchMapped);
+    run("wal", benchWal);
+    run("files", benchFiles);
+    run("icons", benchIcons);
+    run("contents", benchContents);
+    run("scan", benchScan);
+    run("crawl", benchCrawl);
+
+    if (!ran) {
+        std::cerr << "Unknown section: " << section << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -3,6 +3,8 @@
 #include "FileTrie.hpp"
 
 #include <string>
+#include <algorithm>
+#include <queue>
 
 // ALL YOUR CODE SHOULD BE IN THIS FILE. NO MODIFICATIONS SHOULD BE MADE TO FILEAVL / FILE CLASSES
 // You are permitted to make helper functions (and most likely will need to)
@@ -10,42 +12,41 @@
 // Below query(), implement and document all methods declared in FileTrie.hpp
 
 /**
- * @brief Helper function that recursively traverses the tree while adding files if within range of [min,max]
+ * @brief Helper function that traverses the tree in-order while adding files within range of [min,max]
  * 
- * @param subroot Current node to examine whether its in range or not
+ * @param subroot The root of the tree to search
  * @param min The min value of the file size query range.
  * @param max The max value of the file size query range.
  * @param result std::vector<File*> storing pointers to all files in the tree within the given range.
- * @note english translation : for whatever node, if its in range then add those files to the result.
- *      else continue searching left / right 
+ * @pre min <= max
+ * @note english translation : only go left if smaller sizes can still be in range, only go right if larger sizes can.
+ *      that way we only touch the O(log N) nodes on the boundary paths plus the K matching ones,
+ *      and the files come out in ascending order of size.
+ *      uses an explicit stack of the nodes still waiting to be visited instead of recursion
  */
 void FileAVL::search(Node*& subroot, size_t min, size_t max, std::vector<File*>& result) {
-    //base case if null
-    if (!subroot) {
-        return;
-    }
+    Node* stack[MAX_HEIGHT];
+    int depth = 0;
+    Node* current = subroot;
 
-    //when min < max (as intended) find values >= min and <= max
-    if (min <= max) {
-        //if in range, add to result vector
-        if (subroot->size_ >= min && subroot->size_ <= max) {
-            for (const auto things : subroot->files_) {
-                result.push_back(things);
-            }
+    while (current || depth > 0) {
+        //go as far left as is worth going, remembering the nodes we pass
+        while (current) {
+            stack[depth++] = current;
+            //everything on the left is smaller, so only worth visiting if this node is above min
+            current = current->size_ > min ? current->left_ : nullptr;
         }
-    } 
-    //when min > max (unintended) find values >= max and <= min
-    else if (min >= max) {
-        if (subroot->size_ >= max && subroot->size_ <= min) {
-            for (const auto things : subroot->files_) {
-                result.push_back(things);
-            }
+
+        current = stack[--depth];
+
+        //if in range, add to result vector
+        if (current->size_ >= min && current->size_ <= max) {
+            result.insert(result.end(), current->files_.begin(), current->files_.end());
         }
-    } 
-    
-    //search left/right
-    search(subroot->right_,min,max,result);
-    search(subroot->left_,min,max,result);
+
+        //everything on the right is bigger, so only worth visiting if this node is below max
+        current = current->size_ < max ? current->right_ : nullptr;
+    }
 }
 
 /**
@@ -53,13 +54,18 @@ void FileAVL::search(Node*& subroot, size_t min, size_t max, std::vector<File*>&
  * 
  * @param min The min value of the file size query range.
  * @param max The max value of the file size query range.
- * @return std::vector<File*> storing pointers to all files in the tree within the given range.
+ * @return std::vector<File*> storing pointers to all files in the tree within the given range, in ascending order of size.
  * @note If the query interval is in descending order (ie. the given parameters min >= max), 
         the interval from [max, min] is searched (since max >= min)
  */
 std::vector<File*> FileAVL::query(size_t min, size_t max) {
     std::vector<File*> result;
 
+    //when min > max (unintended) search [max, min] instead
+    if (min > max) {
+        std::swap(min, max);
+    }
+
     search(root_, min, max, result);
 
     return result;
@@ -90,68 +96,85 @@ void FileTrie::deleteTrie(FileTrieNode* sub_head) {
 } 
 
 /**
- * @brief Traverses the FileTrie and copies the set of all matching files into the result, if the prefix is valid.
- *      If a single character in the prefix is not valid then the set is cleared and function ends.
+ * @brief Follows the characters of the prefix down from the head of the FileTrie, case insensitive.
  * 
  * @param prefix Prefix that is being searched for
- * @param subroot Current node that is being searched for a matching prefix character
- * @param result Set of files that contain a matching prefix, else empty set
+ * @return The node reached by the last character of the prefix, or nullptr if the prefix is empty or any character is missing
  */
-void FileTrie::searchHelper(const std::string& prefix, FileTrieNode* subroot, std::unordered_set<File*>& result) const {
-    //if empty string dont bother searching
-    if (prefix.empty()) {
-        return;
+FileTrieNode* FileTrie::findPrefix(const std::string& prefix) const {
+    //if empty string (or empty trie) dont bother searching
+    if (prefix.empty() || !head) {
+        return nullptr;
     }
 
-    FileTrieNode* traverse = subroot;
-    auto char_ptr = prefix.begin();
+    FileTrieNode* traverse = head;
 
-    while (char_ptr != prefix.end()) {
-        if (traverse->next.find(tolower(*char_ptr)) != traverse->next.end()) {
-            //if the next char exists in the trie, nest deeper and copy to result
-            traverse = traverse->next[tolower(*char_ptr)];
-            result = traverse->matching;
-        } else {
-            //if the char isn't found then empty out result and return, nothing to see if char isn't found
-            result = {};
-            return;
+    for (char c : prefix) {
+        auto found = traverse->next.find(tolower(c));
+        //if the char isn't found then nothing to see
+        if (found == traverse->next.end()) {
+            return nullptr;
         }
-        ++char_ptr;
+        traverse = found->second;
     }
+    return traverse;
 }
 
 /**
- * @brief Recursively traverses FileTrie if character is found while adding the file into each FileTrieNode's set.
- *      If character is not found then dynamically creates new FileTrieNodes for each new character and inserts file.
+ * @brief Adds every file stored in the given subtree into the result.
+ *      Files are only stored where their name ends, so this walks the whole subtree.
  * 
- * @param head FileTrieNode that is being traversed into
- * @param fileName Name of the file being added into the trie
- * @param f File that is being added to each FileTrieNode's set
+ * @param subroot The root of the subtree whose files are wanted
+ * @param result Set that the files are added to
  */
-void FileTrie::addHelper(FileTrieNode* head, const std::string& fileName, File* f) {
-    if (fileName.empty()) {
-        return;
+void FileTrie::collect(const FileTrieNode* subroot, std::unordered_set<File*>& result) const {
+    result.insert(subroot->files.begin(), subroot->files.end());
+
+    for (const auto& pairs : subroot->next) {
+        collect(pairs.second, result);
     }
+}
 
-    //insert file along the path
-    head->matching.insert(f);
+/**
+ * @brief Walks down the FileTrie one character at a time, creating FileTrieNodes only for characters not seen before,
+ *      and stores the file in the node where its name ends. Every node on the path counts the file on the way down.
+ * 
+ * @param head FileTrieNode to start from
+ * @param fileName The name of the file being added into the trie (viewed, never copied)
+ * @param f File that is being added
+ * @return True if f was added, false if it was already in the trie
+ */
+bool FileTrie::addHelper(FileTrieNode* head, std::string_view fileName, File* f) {
+    size_t size = f->getSize();
+    FileTrieNode* traverse = head;
+
+    for (char c : fileName) {
+        traverse->count++;
+        traverse->max_size = std::max(traverse->max_size, size);
 
-    //case insensitive -> store and search using lower case char
-    char current_char = tolower(fileName[0]);
+        //case insensitive -> store and search using lower case char, and only allocate for a brand new char
+        FileTrieNode*& child = traverse->next[tolower(c)];
+        if (!child) {
+            child = new FileTrieNode(c);
+        }
+        traverse = child;
+    }
 
-    //if find char, traverse deeper into trie
-    if (head->next.find(current_char) != head->next.end()) {
-        //recursively enter nested FileTrieNode's for the given char (from unordered_map)
-        addHelper(head->next[current_char], fileName.substr(1), f);
-    } 
-    //if not found, create trie node for new char and continue adding chars
-    else {
-        FileTrieNode* new_character_node = new FileTrieNode(fileName[0], f);
-        //adding the nested node into next for the given character
-        head->next[current_char] = new_character_node;
+    //end of the name: store the file here (once)
+    if (std::find(traverse->files.begin(), traverse->files.end(), f) == traverse->files.end()) {
+        traverse->count++;
+        traverse->max_size = std::max(traverse->max_size, size);
+        traverse->files.push_back(f);
+        return true;
+    }
 
-        addHelper(new_character_node, fileName.substr(1), f );
+    //already here: take back the counts from the way down (max_size is only an upper bound, so it can stay)
+    traverse = head;
+    for (char c : fileName) {
+        traverse->count--;
+        traverse = traverse->next[tolower(c)];
     }
+    return false;
 }
 
 /**
@@ -177,9 +200,7 @@ void FileTrie::addFile(File* f) {
         //if empty head then create
         head = new FileTrieNode();
     }
-    std::string filename = f->getName();
-
-    addHelper(head, filename, f);
+    addHelper(head, f->getName(), f);
 }
 
 /**
@@ -192,7 +213,264 @@ void FileTrie::addFile(File* f) {
 std::unordered_set<File*> FileTrie::getFilesWithPrefix(const std::string& prefix) const {
     std::unordered_set<File*> result;
 
-    searchHelper(prefix, head, result);
+    FileTrieNode* match = findPrefix(prefix);
+    if (match) {
+        //the count says exactly how many files are coming, so the set never has to rehash
+        result.reserve(match->count);
+        collect(match, result);
+    }
 
     return result;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Looks up some prefix without copying any files, case insensitive
+ * 
+ * @param prefix Prefix that is being searched for
+ * @return A view over all Files with the same prefix; empty if no match is found (or the prefix is empty)
+ */
+FileTrie::PrefixView FileTrie::viewFilesWithPrefix(const std::string& prefix) const {
+    return PrefixView(findPrefix(prefix));
+}
+
+/**
+ * @brief Counts the Files that begin with some prefix in O(prefix length), case insensitive
+ * 
+ * @param prefix Prefix that is being searched for
+ * @return The number of Files with the same prefix, or 0 if no match is found (or the prefix is empty)
+ */
+size_t FileTrie::countWithPrefix(const std::string& prefix) const {
+    FileTrieNode* match = findPrefix(prefix);
+    return match ? match->count : 0;
+}
+
+/**
+ * @brief Constructs the end iterator
+ */
+FileTrie::PrefixIterator::PrefixIterator() : stack{}, index{0} {}
+
+/**
+ * @brief Constructs an iterator positioned at the first file stored in the subtree rooted at subroot
+ */
+FileTrie::PrefixIterator::PrefixIterator(const FileTrieNode* subroot) : stack{}, index{0} {
+    stack.push_back({subroot, subroot->next.begin()});
+    settle();
+}
+
+/**
+ * @brief Moves forward (depth first) until index refers to a file, or the walk is over
+ */
+void FileTrie::PrefixIterator::settle() {
+    while (!stack.empty()) {
+        Frame& top = stack.back();
+
+        //still files left in the current node
+        if (index < top.node->files.size()) {
+            return;
+        }
+
+        //otherwise go down into the next unvisited child, or back up once there are none left
+        if (top.child != top.node->next.end()) {
+            const FileTrieNode* child = top.child->second;
+            ++top.child;
+            stack.push_back({child, child->next.begin()});
+            index = 0;
+        } else {
+            stack.pop_back();
+            //the parent's own files were used up before we went down
+            index = stack.empty() ? 0 : stack.back().node->files.size();
+        }
+    }
+}
+
+/**
+ * @brief Advances to the next file stored in the subtree
+ */
+FileTrie::PrefixIterator& FileTrie::PrefixIterator::operator++() {
+    ++index;
+    settle();
+    return *this;
+}
+
+/**
+ * @brief Two iterators are equal if both are at the end or both point at the same file of the same node
+ */
+bool FileTrie::PrefixIterator::operator==(const PrefixIterator& rhs) const {
+    if (stack.empty() || rhs.stack.empty()) {
+        return stack.empty() == rhs.stack.empty();
+    }
+    return stack.back().node == rhs.stack.back().node && index == rhs.index;
+}
+
+/**
+ * @brief Finds the k largest Files that begin with some prefix, case insensitive.
+ *      Runs best-first using the largest size stored at each node, so the work is proportional
+ *      to the prefix length and k rather than to the number of matches.
+ * 
+ * @param prefix Prefix that is being searched for
+ * @param k The maximum number of Files to return
+ * @return Up to k Files with the same prefix, largest first
+ * @note Sizes are taken as of addFile(); a File whose contents change afterwards may be ranked by its old size
+ */
+std::vector<File*> FileTrie::topKWithPrefix(const std::string& prefix, size_t k) const {
+    std::vector<File*> result;
+    FileTrieNode* match = findPrefix(prefix);
+    if (!match || k == 0) {
+        return result;
+    }
+
+    //a candidate is either a whole subtree (ranked by the biggest file anywhere inside it) or a single file
+    struct Candidate {
+        size_t bound;
+        const FileTrieNode* node;
+        File* file;
+        bool operator<(const Candidate& rhs) const { return bound < rhs.bound; }
+    };
+    std::priority_queue<Candidate> frontier;
+    frontier.push({match->max_size, match, nullptr});
+
+    //nothing left in the queue can beat what is on top, so a file on top is the next best overall
+    while (!frontier.empty() && result.size() < k) {
+        Candidate best = frontier.top();
+        frontier.pop();
+
+        if (best.file) {
+            result.push_back(best.file);
+            continue;
+        }
+        for (File* f : best.node->files) {
+            frontier.push({f->getSize(), nullptr, f});
+        }
+        for (const auto& pairs : best.node->next) {
+            frontier.push({pairs.second->max_size, pairs.second, nullptr});
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Finds the k highest-scoring Files that begin with some prefix, case insensitive.
+ *      An arbitrary score cannot be bounded per node, so every match is scored once, keeping only the best k.
+ * 
+ * @param prefix Prefix that is being searched for
+ * @param k The maximum number of Files to return
+ * @param score Ranks a File (eg. by recency or access frequency); higher is better
+ * @return Up to k Files with the same prefix, highest score first
+ */
+std::vector<File*> FileTrie::topKWithPrefix(const std::string& prefix, size_t k, const std::function<double(const File*)>& score) const {
+    std::vector<File*> result;
+    if (k == 0) {
+        return result;
+    }
+
+    //min-heap of the best k so far, so the weakest is always the one to evict
+    using Scored = std::pair<double, File*>;
+    std::priority_queue<Scored, std::vector<Scored>, std::greater<Scored>> best;
+
+    for (File* f : viewFilesWithPrefix(prefix)) {
+        double s = score(f);
+        if (best.size() < k) {
+            best.push({s, f});
+        } else if (s > best.top().first) {
+            best.pop();
+            best.push({s, f});
+        }
+    }
+
+    result.resize(best.size());
+    for (size_t i = result.size(); i > 0; --i) {
+        result[i - 1] = best.top().second;
+        best.pop();
+    }
+    return result;
+}
+
+/**
+ * @brief Extends the edit distance table by the character c leading into node, then either takes the whole subtree,
+ *      gives up on it, or carries on into the children.
+ * 
+ * @param node The node reached by c
+ * @param c The (lower case) character on the edge into node
+ * @param query The lower case prefix being searched for
+ * @param max_distance The most edits allowed
+ * @param rows rows[depth] is the row of the node above: the distance from each prefix of query to the path so far
+ * @param depth The depth of the node above
+ * @param matches Receives the roots of the subtrees whose files all match
+ */
+void FileTrie::fuzzyHelper(const FileTrieNode* node, char c, const std::string& query, size_t max_distance,
+                           std::vector<std::vector<size_t>>& rows, size_t depth, std::vector<const FileTrieNode*>& matches) const {
+    //rows are reused between siblings, so each depth only ever allocates once per search
+    if (rows.size() <= depth + 1) {
+        rows.emplace_back(query.size() + 1);
+    }
+    const std::vector<size_t>& above = rows[depth];
+    std::vector<size_t>& row = rows[depth + 1];
+
+    row[0] = above[0] + 1;
+    size_t lowest = row[0];
+    for (size_t j = 1; j <= query.size(); j++) {
+        size_t substitute = above[j - 1] + (query[j - 1] != c);
+        row[j] = std::min({above[j] + 1, row[j - 1] + 1, substitute});
+        lowest = std::min(lowest, row[j]);
+    }
+
+    //the whole query is within reach of the path so far: every name below starts with a close enough prefix
+    if (row[query.size()] <= max_distance) {
+        matches.push_back(node);
+        return;
+    }
+    //every entry only grows further down, so nothing below can come back within reach
+    if (lowest > max_distance) {
+        return;
+    }
+    for (const auto& pairs : node->next) {
+        fuzzyHelper(pairs.second, pairs.first, query, max_distance, rows, depth + 1, matches);
+    }
+}
+
+/**
+ * @brief Finds the Files that begin with something within max_distance edits (insertions, deletions or
+ *      substitutions) of some prefix, case insensitive. Walks the FileTrie keeping one row of the edit distance
+ *      table per node, and skips a subtree as soon as no entry of its row is within max_distance.
+ * 
+ * @param prefix Prefix that is being searched for, possibly misspelt
+ * @param max_distance The most edits allowed between the prefix and the start of a name
+ * @return Set of all Files whose name starts within max_distance edits of the prefix, or an empty set if
+ *      none do (or the prefix is empty)
+ */
+std::unordered_set<File*> FileTrie::getFilesWithFuzzyPrefix(const std::string& prefix, size_t max_distance) const {
+    std::unordered_set<File*> result;
+    if (prefix.empty() || !head) {
+        return result;
+    }
+
+    std::string query = prefix;
+    std::transform(query.begin(), query.end(), query.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    //the row for the empty path: reaching each prefix of the query from nothing takes that many insertions
+    std::vector<std::vector<size_t>> rows(1, std::vector<size_t>(query.size() + 1));
+    for (size_t j = 0; j <= query.size(); j++) {
+        rows[0][j] = j;
+    }
+
+    //so short that deleting all of it is allowed: everything matches
+    std::vector<const FileTrieNode*> matches;
+    if (query.size() <= max_distance) {
+        matches.push_back(head);
+    } else {
+        for (const auto& pairs : head->next) {
+            fuzzyHelper(pairs.second, pairs.first, query, max_distance, rows, 0, matches);
+        }
+    }
+
+    //matching subtrees never nest, so their counts add up to exactly how many files are coming
+    size_t total = 0;
+    for (const FileTrieNode* match : matches) {
+        total += match->count;
+    }
+    result.reserve(total);
+    for (const FileTrieNode* match : matches) {
+        collect(match, result);
+    }
+    return result;
+}